@@ -0,0 +1,215 @@
+#include "ast.h"
+#include <cstring>
+
+using namespace std;
+
+// Slot 0 is the NO_NODE sentinel
+Ast::Ast() : nodes(1, Node()), root(NO_NODE) {}
+
+void Ast::reset(string_view src, size_t expectedNodes) {
+    source = src;
+    nodes.assign(1, Node());
+    nodes.reserve(expectedNodes + 1);
+    root = NO_NODE;
+}
+
+NodeId Ast::add(NodeKind kind) {
+    Node node = {};
+    node.kind = kind;
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+NodeId Ast::add(NodeKind kind, const Token& token) {
+    NodeId id = add(kind);
+    nodes[id].offset = token.offset;
+    nodes[id].length = token.lexeme.size();
+    nodes[id].d = token.symbol;
+    return id;
+}
+
+void Ast::append(NodeList& list, NodeId id) {
+    if (id == NO_NODE) return;
+    if (list.last == NO_NODE) list.first = id;
+    else nodes[list.last].next = id;
+    list.last = id;
+    list.count++;
+}
+
+NodeId Ast::graft(const Ast& fragment, int64_t shift) {
+    // Fragment node 2 (the first after its root) lands at the end of nodes
+    NodeId renumber = nodes.size() - 2;
+    auto relocate = [renumber](NodeId id) { return id == NO_NODE ? NO_NODE : id + renumber; };
+    
+    for (size_t id = 2; id < fragment.nodes.size(); id++) {
+        Node node = fragment.nodes[id];
+        
+        // Literals keep their value in a and b, named nodes their symbol in d
+        bool literal = node.kind == NodeKind::IntLiteral || node.kind == NodeKind::FloatLiteral ||
+                       node.kind == NodeKind::BoolLiteral;
+        if (!literal) {
+            node.a = relocate(node.a);
+            node.b = relocate(node.b);
+        }
+        node.c = relocate(node.c);
+        if (node.kind == NodeKind::Iterate) node.d = relocate(node.d);
+        node.next = relocate(node.next);
+        if (node.length > 0) node.offset += shift;
+        nodes.push_back(node);
+    }
+    return relocate(fragment.nodes[fragment.root].a);
+}
+
+void Ast::setInt(NodeId id, int64_t value) {
+    uint64_t bits = (uint64_t)value;
+    nodes[id].a = (uint32_t)bits;
+    nodes[id].b = (uint32_t)(bits >> 32);
+}
+
+void Ast::setFloat(NodeId id, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    nodes[id].a = (uint32_t)bits;
+    nodes[id].b = (uint32_t)(bits >> 32);
+}
+
+int64_t Ast::intValue(NodeId id) const {
+    return (int64_t)(((uint64_t)nodes[id].b << 32) | nodes[id].a);
+}
+
+double Ast::floatValue(NodeId id) const {
+    uint64_t bits = ((uint64_t)nodes[id].b << 32) | nodes[id].a;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// ==================== Printing ====================
+
+const char* nodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::Program: return "Program";
+        case NodeKind::Link: return "Link";
+        case NodeKind::Network: return "Network";
+        case NodeKind::Param: return "Param";
+        case NodeKind::Init: return "Init";
+        case NodeKind::Declaration: return "Declaration";
+        case NodeKind::Assign: return "Assign";
+        case NodeKind::If: return "If";
+        case NodeKind::Until: return "Until";
+        case NodeKind::Iterate: return "Iterate";
+        case NodeKind::Feed: return "Feed";
+        case NodeKind::Forward: return "Forward";
+        case NodeKind::Yield: return "Yield";
+        case NodeKind::IntLiteral: return "IntLiteral";
+        case NodeKind::FloatLiteral: return "FloatLiteral";
+        case NodeKind::StringLiteral: return "StringLiteral";
+        case NodeKind::BoolLiteral: return "BoolLiteral";
+        case NodeKind::Identifier: return "Identifier";
+        case NodeKind::Call: return "Call";
+        case NodeKind::Unary: return "Unary";
+        case NodeKind::Binary: return "Binary";
+    }
+    return "Unknown";
+}
+
+static void dumpNode(const Ast& ast, ostream& out, NodeId id, int depth);
+
+// Print a labelled list of nodes one level deeper
+static void dumpList(const Ast& ast, ostream& out, const char* label, NodeId first, int depth) {
+    out << string(depth * 2, ' ') << label << "\n";
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) {
+        dumpNode(ast, out, id, depth + 1);
+    }
+}
+
+static void dumpNode(const Ast& ast, ostream& out, NodeId id, int depth) {
+    const Node& node = ast.node(id);
+    out << string(depth * 2, ' ') << nodeKindName(node.kind);
+    
+    switch (node.kind) {
+        case NodeKind::Param:
+        case NodeKind::Declaration:
+            out << " " << tokenTypeToString((TokenType)node.op) << " " << ast.text(id);
+            break;
+        case NodeKind::Unary:
+        case NodeKind::Binary:
+            out << " " << tokenTypeToString((TokenType)node.op);
+            break;
+        case NodeKind::IntLiteral:
+            out << " " << ast.intValue(id);
+            break;
+        case NodeKind::FloatLiteral:
+            out << " " << ast.floatValue(id);
+            break;
+        case NodeKind::BoolLiteral:
+            out << " " << (node.a ? "true" : "false");
+            break;
+        case NodeKind::Program:
+        case NodeKind::Init:
+        case NodeKind::If:
+        case NodeKind::Until:
+        case NodeKind::Iterate:
+        case NodeKind::Forward:
+        case NodeKind::Yield:
+            break;
+        default:
+            out << " " << ast.text(id);
+            break;
+    }
+    out << "\n";
+    
+    switch (node.kind) {
+        case NodeKind::Program:
+            for (NodeId child = node.a; child != NO_NODE; child = ast.node(child).next) {
+                dumpNode(ast, out, child, depth + 1);
+            }
+            break;
+        case NodeKind::Network:
+            for (NodeId param = node.a; param != NO_NODE; param = ast.node(param).next) {
+                dumpNode(ast, out, param, depth + 1);
+            }
+            dumpList(ast, out, "Body", node.b, depth + 1);
+            break;
+        case NodeKind::Init:
+            dumpList(ast, out, "Body", node.a, depth + 1);
+            break;
+        case NodeKind::If:
+            dumpNode(ast, out, node.a, depth + 1);
+            dumpList(ast, out, "Then", node.b, depth + 1);
+            if (node.c != NO_NODE) dumpList(ast, out, "Else", node.c, depth + 1);
+            break;
+        case NodeKind::Until:
+            dumpNode(ast, out, node.a, depth + 1);
+            dumpList(ast, out, "Body", node.b, depth + 1);
+            break;
+        case NodeKind::Iterate:
+            if (node.a != NO_NODE) dumpNode(ast, out, node.a, depth + 1);
+            if (node.b != NO_NODE) dumpNode(ast, out, node.b, depth + 1);
+            if (node.c != NO_NODE) dumpNode(ast, out, node.c, depth + 1);
+            dumpList(ast, out, "Body", node.d, depth + 1);
+            break;
+        case NodeKind::Declaration:
+        case NodeKind::Assign:
+        case NodeKind::Forward:
+        case NodeKind::Yield:
+        case NodeKind::Unary:
+            if (node.a != NO_NODE) dumpNode(ast, out, node.a, depth + 1);
+            break;
+        case NodeKind::Call:
+            for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) {
+                dumpNode(ast, out, arg, depth + 1);
+            }
+            break;
+        case NodeKind::Binary:
+            dumpNode(ast, out, node.a, depth + 1);
+            dumpNode(ast, out, node.b, depth + 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void Ast::dump(ostream& out) const {
+    if (root != NO_NODE) dumpNode(*this, out, root, 0);
+}
@@ -0,0 +1,130 @@
+#ifndef AST_H
+#define AST_H
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+using namespace std;
+
+// Index of a node in its Ast; 0 is reserved to mean "no node"
+typedef uint32_t NodeId;
+const NodeId NO_NODE = 0;
+
+// Kinds of AST nodes
+enum class NodeKind : uint8_t {
+    // Statements
+    Program, Link, Network, Param, Init, Declaration, Assign,
+    If, Until, Iterate, Feed, Forward, Yield,
+    
+    // Expressions
+    IntLiteral, FloatLiteral, StringLiteral, BoolLiteral,
+    Identifier, Call, Unary, Binary
+};
+
+// AST node - 32 bytes, children referenced by index
+// Field use by kind (lists are chained through `next`):
+//   Program       a = first statement
+//   Link          text = path literal (with quotes)
+//   Network       text = name, a = first Param, b = first body statement,
+//                 count = parameter count
+//   Param         text = name, op = data type
+//   Init          a = first body statement
+//   Declaration   text = name, op = data type, a = initializer (optional)
+//   Assign        text = target name, a = value
+//   If            a = condition, b = then body, c = else body
+//   Until         a = condition, b = body
+//   Iterate       a = init Declaration, b = condition, c = update Assign,
+//                 d = body (all optional)
+//   Feed          text = target name
+//   Forward       a = value
+//   Yield         a = value
+//   IntLiteral    a/b = low/high 32 bits of the value
+//   FloatLiteral  a/b = low/high 32 bits of the IEEE double
+//   StringLiteral text = literal (with quotes)
+//   BoolLiteral   a = 0 or 1
+//   Identifier    text = name
+//   Call          text = callee name, a = first argument, count = argument count
+//   Unary         op = operator, a = operand
+//   Binary        op = operator, a = left, b = right
+// Nodes whose text is a name (Network, Param, Declaration, Assign, Feed,
+// Identifier, Call) keep the name's symbol id in d; see symbol().
+struct Node {
+    NodeKind kind;
+    uint8_t op;             // TokenType of the operator or data type
+    uint16_t count;         // Length of the parameter/argument list
+    uint32_t offset;        // Source text of the node (name, literal, keyword)
+    uint32_t length;
+    NodeId a, b, c, d;      // Children (see table above)
+    NodeId next;            // Next node in the enclosing list
+};
+
+// Longest parameter or argument list a node can count; the parser
+// rejects longer ones
+const uint16_t MAX_LIST_LENGTH = UINT16_MAX;
+
+// Head and tail of a node list under construction
+struct NodeList {
+    NodeId first = NO_NODE;
+    NodeId last = NO_NODE;
+    uint16_t count = 0;     // Only meaningful up to MAX_LIST_LENGTH
+};
+
+// Ast - all nodes of one compilation unit
+// Nodes live in one contiguous append-only array that acts as a bump
+// allocator: creating a node is a push, children are 32-bit indices, and
+// the whole tree is released at once with the Ast. Like Token, nodes refer
+// to source text by offset, so the source must outlive any text lookups.
+class Ast {
+private:
+    vector<Node> nodes;
+    string_view source;
+    NodeId root;
+    
+public:
+    Ast();
+    
+    // Start a new tree over source; expectedNodes sizes the arena
+    void reset(string_view source, size_t expectedNodes = 0);
+    
+    // Create a node, optionally taking its text (and symbol) from a token
+    NodeId add(NodeKind kind);
+    NodeId add(NodeKind kind, const Token& token);
+    
+    // Append a node to a list (ignores NO_NODE)
+    void append(NodeList& list, NodeId id);
+    
+    // Copy the nodes of a tree parsed from part of the same source after
+    // this tree's nodes, renumbering their links and moving their text by
+    // shift bytes (for a fragment parsed before an edit earlier in the
+    // source). The fragment's root (its first node, a Program) is left out;
+    // returns the copy of its first statement.
+    NodeId graft(const Ast& fragment, int64_t shift = 0);
+    
+    Node& node(NodeId id) { return nodes[id]; }
+    const Node& node(NodeId id) const { return nodes[id]; }
+    string_view text(NodeId id) const { return source.substr(nodes[id].offset, nodes[id].length); }
+    SymbolId symbol(NodeId id) const { return nodes[id].d; }
+    
+    // Literal payloads
+    void setInt(NodeId id, int64_t value);
+    void setFloat(NodeId id, double value);
+    int64_t intValue(NodeId id) const;
+    double floatValue(NodeId id) const;
+    
+    NodeId getRoot() const { return root; }
+    void setRoot(NodeId id) { root = id; }
+    
+    // Number of nodes (excluding the reserved NO_NODE slot)
+    size_t size() const { return nodes.size() - 1; }
+    size_t memoryBytes() const { return nodes.capacity() * sizeof(Node); }
+    
+    // Print the tree in indented form
+    void dump(ostream& out) const;
+};
+
+const char* nodeKindName(NodeKind kind);
+
+#endif // AST_H
@@ -0,0 +1,199 @@
+#include "batch.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "resolver.h"
+#include "source_file.h"
+#include "task_pool.h"
+#include "type_checker.h"
+#include "token_cache.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// ==================== Input Collection ====================
+
+// Add every *.netc file below dir, sorted so the order is reproducible
+static bool collectDirectory(const string& dir, vector<string>& files, string& error) {
+    vector<string> found;
+    error_code ec;
+    fs::recursive_directory_iterator it(dir, ec), end;
+    
+    for (; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && it->path().extension() == ".netc") {
+            found.push_back(it->path().string());
+        }
+    }
+    if (ec) {
+        error = "Could not read directory '" + dir + "': " + ec.message();
+        return false;
+    }
+    
+    sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+    return true;
+}
+
+// Add the paths listed in a manifest file
+static bool collectManifest(const string& manifest, vector<string>& files, string& error) {
+    ifstream in(manifest);
+    if (!in.is_open()) {
+        error = "Could not open manifest '" + manifest + "'";
+        return false;
+    }
+    
+    fs::path base = fs::path(manifest).parent_path();
+    string line;
+    while (getline(in, line)) {
+        // Trim surrounding whitespace (including '\r' from CRLF files)
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        fs::path entry = line.substr(first, last - first + 1);
+        
+        files.push_back(entry.is_absolute() ? entry.string() : (base / entry).string());
+    }
+    return true;
+}
+
+bool isBatchInput(const vector<string>& inputs) {
+    error_code ec;
+    return inputs.size() > 1 || 
+           (inputs.size() == 1 && ((inputs[0].size() > 1 && inputs[0][0] == '@') || 
+                                   fs::is_directory(inputs[0], ec)));
+}
+
+bool collectBatchInputs(const vector<string>& inputs, vector<string>& files, string& error) {
+    for (const string& input : inputs) {
+        error_code ec;
+        bool ok = true;
+        
+        if (input.size() > 1 && input[0] == '@') {
+            ok = collectManifest(input.substr(1), files, error);
+        } else if (fs::is_directory(input, ec)) {
+            ok = collectDirectory(input, files, error);
+        } else {
+            // Missing files are reported per file by runBatch
+            files.push_back(input);
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// ==================== Compilation ====================
+
+// Run a quiet parse
+static void runParser(Parser& parser, const BatchOptions& options) {
+    parser.setVerbosity(-1);
+    parser.setMaxDepth(options.maxDepth);
+    parser.parse();
+}
+
+// Resolve names, then check types, of a cleanly parsed file, adding any
+// errors to its diagnostics. Calls into linked modules are not checked here.
+static void runSemantic(Parser& parser, const Scanner& scanner, const BatchOptions& options,
+                        Diagnostics& diagnostics) {
+    if (parser.hasError()) return;
+    Resolver resolver(parser.getAst(), scanner.getInterner(), scanner.lineIndex());
+    resolver.resolve();
+    diagnostics.append(resolver.getDiagnostics());
+    if (resolver.hasError()) return;
+    
+    TypeChecker checker(parser.getAst(), resolver, scanner.lineIndex());
+    checker.setMaxDepth(options.maxDepth);
+    checker.check();
+    diagnostics.append(checker.getDiagnostics());
+}
+
+// Compile one file as a module of the loader and load everything it links
+// to. Each worker walks its own link graph; modules shared between files
+// (or that are inputs themselves) load only once.
+static void compileModule(const string& path, const BatchOptions& options, BatchResult& result) {
+    result.path = path;
+    ModuleLoader& loader = *options.loader;
+    const Module& module = loader.get(ModuleLoader::canonicalPath(path));
+    
+    if (module.scanner) result.tokens = module.scanner->getBuffer().size();
+    result.diagnostics = module.diagnostics;
+    loader.loadAll(path, module.links, 1);
+}
+
+// Scan and parse one file into its result slot
+static void compileFile(const string& path, const BatchOptions& options, BatchResult& result) {
+    result.path = path;
+    
+    SourceFile source;
+    if (!source.open(path)) {
+        result.diagnostics.report(DiagnosticPhase::Driver, 0, 0, 
+                                  "Could not open file '" + path + "'");
+        return;
+    }
+    
+    Scanner scanner(source);
+    scanner.setMode(options.scanMode);
+    
+    // Without a cache, tokens stream straight into the parser
+    if (!options.useCache && !options.scanOnly) {
+        Parser parser(scanner);
+        runParser(parser, options);
+        result.tokens = parser.tokenCount();
+        
+        // Scan whatever the parser left unread so every lexical error is reported
+        while (scanner.nextToken().type != END_OF_FILE) {}
+        result.diagnostics = scanner.getDiagnostics();
+        result.diagnostics.append(parser.getDiagnostics());
+        runSemantic(parser, scanner, options, result.diagnostics);
+        return;
+    }
+    
+    TokenCache cache;
+    string cachePath = options.useCache ? TokenCache::pathFor(path) : "";
+    result.cached = options.useCache && scanner.loadCache(cache, cachePath);
+    if (!result.cached) {
+        scanner.scanBuffer();
+        if (options.useCache && scanner.getDiagnostics().empty()) {
+            TokenCache::save(cachePath, source.text(), scanner.getBuffer());
+        }
+    }
+    result.tokens = scanner.getBuffer().size();
+    
+    if (options.scanOnly) {
+        result.diagnostics = scanner.getDiagnostics();
+        return;
+    }
+    
+    Parser parser(scanner.getBuffer());
+    runParser(parser, options);
+    result.diagnostics = scanner.getDiagnostics();
+    result.diagnostics.append(parser.getDiagnostics());
+    runSemantic(parser, scanner, options, result.diagnostics);
+}
+
+vector<BatchResult> runBatch(const vector<string>& files, const BatchOptions& options) {
+    vector<BatchResult> results(files.size());
+    
+    // Every task writes only its own slot, so no locking is needed and the
+    // results come out in input order however the work was scheduled
+    TaskPool pool(options.jobs);
+    pool.run(files.size(), [&](size_t i) {
+        if (options.loader) compileModule(files[i], options, results[i]);
+        else compileFile(files[i], options, results[i]);
+    });
+    return results;
+}
+
+size_t reportBatch(const vector<BatchResult>& results, FILE* out) {
+    string report;
+    size_t failed = 0;
+    
+    for (const BatchResult& result : results) {
+        if (result.diagnostics.empty()) continue;
+        report += result.diagnostics.render(result.path + ": ");
+        failed++;
+    }
+    
+    fwrite(report.data(), 1, report.size(), out);
+    fflush(out);
+    return failed;
+}
@@ -0,0 +1,53 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "diagnostics.h"
+#include "module_loader.h"
+#include "parser.h"
+#include "scanner.h"
+
+using namespace std;
+
+// Settings shared by every file of a batch
+struct BatchOptions {
+    unsigned jobs = 0;                              // Worker threads (0 = one per hardware thread)
+    bool scanOnly = false;                          // Skip parsing
+    bool useCache = false;                          // Reuse/save .ntok token caches
+    ScanMode scanMode = ScanMode::Switch;
+    size_t maxDepth = Parser::DEFAULT_MAX_DEPTH;
+    ModuleLoader* loader = nullptr;                 // Compile through a loader and load linked modules
+};
+
+// Outcome of compiling one file
+struct BatchResult {
+    string path;
+    bool cached = false;        // Tokens came from an .ntok cache
+    size_t tokens = 0;          // Tokens scanned (or parsed, when streaming)
+    Diagnostics diagnostics;    // Scanner, parser, then semantic errors
+};
+
+// True if the inputs call for batch mode: more than one input, or a
+// directory or manifest
+bool isBatchInput(const vector<string>& inputs);
+
+// Expand batch inputs into a list of source files. An input is a file, a
+// directory (searched recursively for *.netc, in sorted order) or
+// "@manifest", a file listing one path per line (blank lines and lines
+// starting with '#' are skipped; relative paths are taken relative to the
+// manifest). Returns false and sets error if an input cannot be read.
+bool collectBatchInputs(const vector<string>& inputs, vector<string>& files, string& error);
+
+// Scan, parse and check every file on a work-stealing pool. Each file gets its
+// own SourceFile, Scanner and Parser; results[i] belongs to files[i]. With
+// a loader, files are compiled as modules of it (never streamed or cached),
+// so an input that another input links to is still compiled only once.
+vector<BatchResult> runBatch(const vector<string>& files, const BatchOptions& options);
+
+// Write each file's diagnostics (in input order, prefixed with its path)
+// to out in one write; returns the number of files with errors
+size_t reportBatch(const vector<BatchResult>& results, FILE* out);
+
+#endif // BATCH_H
@@ -0,0 +1,118 @@
+#include "bytecode.h"
+#include <iomanip>
+
+using namespace std;
+
+// Opcode names, indexed by Opcode
+static const char* const opcodeNameTable[] = {
+    "MOVE", "MOVE_TEXT", "LOAD_INT", "LOAD_CONST", "LOAD_TEXT",
+    "GET_GLOBAL", "SET_GLOBAL", "GET_GLOBAL_TEXT", "SET_GLOBAL_TEXT",
+    "DNUM_TO_CNUM", "CNUM_TO_DNUM",
+    "ADD_D", "SUB_D", "MUL_D", "DIV_D", "MOD_D",
+    "NEG_D", "INC_D", "DEC_D",
+    "ADD_C", "SUB_C", "MUL_C", "DIV_C",
+    "NEG_C", "INC_C", "DEC_C",
+    "CONCAT",
+    "BIT_AND", "BIT_OR", "BIT_XOR", "SHIFT_LEFT", "SHIFT_RIGHT",
+    "BIT_NOT", "NOT",
+    "EQ_D", "NE_D", "LT_D", "LE_D",
+    "EQ_C", "NE_C", "LT_C", "LE_C",
+    "EQ_TEXT", "NE_TEXT",
+    "JUMP", "JUMP_IF_FALSE", "JUMP_IF_TRUE",
+    "CALL", "CALL_TEXT", "ARGS",
+    "RETURN", "RETURN_TEXT", "RETURN_VOID",
+    "FEED_D", "FEED_C", "FEED_FLAG", "FEED_TEXT",
+    "FORWARD_D", "FORWARD_C", "FORWARD_FLAG", "FORWARD_TEXT"
+};
+
+static_assert(sizeof(opcodeNameTable) / sizeof(opcodeNameTable[0]) == OPCODE_COUNT,
+              "one name per opcode");
+static_assert(sizeof(Instruction) == 8, "instructions are 8 bytes");
+
+const char* opcodeName(Opcode op) {
+    return (size_t)op < OPCODE_COUNT ? opcodeNameTable[(size_t)op] : "UNKNOWN";
+}
+
+size_t BytecodeProgram::memoryBytes() const {
+    size_t bytes = code.capacity() * sizeof(Instruction) + origins.capacity() * sizeof(uint32_t) +
+                   constants.capacity() * sizeof(Value) + functions.capacity() * sizeof(BytecodeFunction);
+    for (const string& text : texts) bytes += sizeof(string) + text.capacity();
+    return bytes;
+}
+
+// Operands of one instruction: r = register, t = text register
+static void dumpOperands(ostream& out, const BytecodeProgram& program, const Instruction& in) {
+    switch (in.op) {
+        case Opcode::Move: case Opcode::DnumToCnum: case Opcode::CnumToDnum:
+        case Opcode::NegD: case Opcode::IncD: case Opcode::DecD:
+        case Opcode::NegC: case Opcode::IncC: case Opcode::DecC:
+        case Opcode::BitNot: case Opcode::Not:
+            out << "r" << in.a << ", r" << in.b;
+            break;
+        case Opcode::MoveText:
+            out << "t" << in.a << ", t" << in.b;
+            break;
+        case Opcode::LoadInt:
+            out << "r" << in.a << ", " << (int32_t)in.wide();
+            break;
+        case Opcode::LoadConst: {
+            Value value = program.constants[in.wide()];
+            out << "r" << in.a << ", k" << in.wide() << " (" << value.dnum << " / " << value.cnum << ")";
+            break;
+        }
+        case Opcode::LoadText:
+            out << "t" << in.a << ", \"" << program.texts[in.wide()] << "\"";
+            break;
+        case Opcode::GetGlobal: case Opcode::SetGlobal:
+            out << "r" << in.a << ", g" << in.wide();
+            break;
+        case Opcode::GetGlobalText: case Opcode::SetGlobalText:
+            out << "t" << in.a << ", g" << in.wide();
+            break;
+        case Opcode::Concat:
+        case Opcode::EqText: case Opcode::NeText:
+            out << (in.op == Opcode::Concat ? "t" : "r") << in.a << ", t" << in.b << ", t" << in.c;
+            break;
+        case Opcode::Jump:
+            out << "@" << in.wide();
+            break;
+        case Opcode::JumpIfFalse: case Opcode::JumpIfTrue:
+            out << "r" << in.a << ", @" << in.wide();
+            break;
+        case Opcode::Call: case Opcode::CallText:
+            out << (in.op == Opcode::Call ? "r" : "t") << in.a << ", "
+                << program.functions[in.wide()].name;
+            break;
+        case Opcode::Args:
+            out << "r" << in.a << ", t" << in.b;
+            break;
+        case Opcode::Return: case Opcode::FeedD: case Opcode::FeedC: case Opcode::FeedFlag:
+        case Opcode::ForwardD: case Opcode::ForwardC: case Opcode::ForwardFlag:
+            out << "r" << in.a;
+            break;
+        case Opcode::ReturnText: case Opcode::FeedText: case Opcode::ForwardText:
+            out << "t" << in.a;
+            break;
+        case Opcode::ReturnVoid:
+            break;
+        default:
+            out << "r" << in.a << ", r" << in.b << ", r" << in.c;
+            break;
+    }
+}
+
+void BytecodeProgram::dump(ostream& out) const {
+    for (size_t f = 0; f < functions.size(); f++) {
+        const BytecodeFunction& function = functions[f];
+        uint32_t end = f + 1 < functions.size() ? functions[f + 1].entry : code.size();
+        
+        out << function.name << " (" << function.registers << " registers, "
+            << function.textRegisters << " text registers) yields "
+            << valueTypeName(function.result) << "\n";
+        for (uint32_t pc = function.entry; pc < end; pc++) {
+            out << setw(8) << pc << "  " << left << setw(16) << opcodeName(code[pc].op) << right;
+            dumpOperands(out, *this, code[pc]);
+            out << "\n";
+        }
+    }
+}
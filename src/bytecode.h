@@ -0,0 +1,103 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "runtime.h"
+
+using namespace std;
+
+// Bytecode operations. Suffix D works on dnums, C on cnums; flags are
+// dnums 0 and 1. Registers named by a, b and c are frame-relative; text
+// values live in a register bank of their own. "k" is the 32-bit operand
+// in b and c (see Instruction::wide).
+enum class Opcode : uint8_t {
+    Move,           // a = b
+    MoveText,       // text a = text b
+    LoadInt,        // a = k (sign-extended)
+    LoadConst,      // a = constants[k]
+    LoadText,       // text a = texts[k]
+    GetGlobal,      // a = globals[k]
+    SetGlobal,      // globals[k] = a
+    GetGlobalText,  // text a = textGlobals[k]
+    SetGlobalText,  // textGlobals[k] = text a
+    DnumToCnum,     // a = (cnum) b
+    CnumToDnum,     // a = (dnum) b, truncated
+    
+    AddD, SubD, MulD, DivD, ModD,   // a = b op c
+    NegD, IncD, DecD,               // a = -b, b + 1, b - 1
+    AddC, SubC, MulC, DivC,
+    NegC, IncC, DecC,
+    Concat,                         // text a = text b + text c
+    BitAnd, BitOr, BitXor, ShiftLeft, ShiftRight,
+    BitNot,                         // a = ~b
+    Not,                            // a = !b
+    EqD, NeD, LtD, LeD,             // a = b op c (> and >= swap b and c)
+    EqC, NeC, LtC, LeC,
+    EqText, NeText,                 // a = text b op text c
+    
+    Jump,           // go to k
+    JumpIfFalse,    // go to k if a is 0
+    JumpIfTrue,     // go to k if a is not 0
+    Call,           // a = functions[k](...), the next word is Args
+    CallText,       // text a = functions[k](...), the next word is Args
+    Args,           // Arguments start at register a and text register b
+    Return,         // yield a
+    ReturnText,     // yield text a
+    ReturnVoid,     // end a network without a value
+    
+    FeedD, FeedC, FeedFlag, FeedText,                   // read into a
+    ForwardD, ForwardC, ForwardFlag, ForwardText        // write a
+};
+
+const size_t OPCODE_COUNT = (size_t)Opcode::ForwardText + 1;
+
+const char* opcodeName(Opcode op);
+
+// One 8-byte instruction
+struct Instruction {
+    Opcode op;
+    uint8_t unused;
+    uint16_t a, b, c;
+    
+    uint32_t wide() const { return b | (uint32_t)c << 16; }
+};
+
+// A compiled network or init() body. Its first parameters are its first
+// registers (dnums, cnums and flags in one bank, texts in the other, each
+// in parameter order), so a call moves no arguments: the caller computes
+// them into the registers the callee's frame starts at.
+struct BytecodeFunction {
+    NodeId node;            // Network or Init node (NO_NODE for the start code)
+    string name;
+    uint32_t entry;         // First instruction
+    uint32_t registers;     // Registers used by a frame
+    uint32_t textRegisters;
+    ValueType result;       // Type yielded (Void if none)
+};
+
+// BytecodeProgram - a compiled NetC program
+// functions[0] is the start code: the top-level statements in order, then
+// a call to init(); the value it yields is the program's result. Code is
+// one array shared by all functions; origins[pc] is the source offset of
+// the node an instruction came from, for runtime error positions.
+struct BytecodeProgram {
+    vector<Instruction> code;
+    vector<uint32_t> origins;
+    vector<Value> constants;        // dnums too wide for LoadInt, and cnums
+    vector<string> texts;           // Text literals (texts[0] is "")
+    vector<BytecodeFunction> functions;
+    uint32_t globals = 0;           // Top-level dnum/cnum/flag variables
+    uint32_t textGlobals = 0;       // Top-level text variables
+    
+    size_t memoryBytes() const;
+    
+    // Print every function as a numbered instruction listing
+    void dump(ostream& out) const;
+};
+
+#endif // BYTECODE_H
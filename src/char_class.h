@@ -0,0 +1,112 @@
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <cstdint>
+#include "token.h"
+
+using namespace std;
+
+// Character classes for the table-driven scanner
+// Every byte maps to one class. Each operator character gets a class of its
+// own so the operator DFA below can be indexed by class instead of by byte.
+enum CharClass : uint8_t {
+    CC_OTHER,       // Anything not valid in NetC source
+    CC_BLANK,       // ' ', '\t', '\r'
+    CC_NEWLINE,     // '\n'
+    CC_DIGIT,       // 0-9
+    CC_ALPHA,       // A-Z, a-z, _
+    CC_QUOTE,       // "
+    CC_HASH,        // # (comment start)
+    
+    // Operator and delimiter characters
+    CC_LPAREN, CC_RPAREN, CC_LBRACE, CC_RBRACE, CC_LBRACKET, CC_RBRACKET,
+    CC_SEMICOLON, CC_COMMA, CC_TILDE, CC_CARET, CC_PERCENT,
+    CC_PLUS, CC_MINUS, CC_STAR, CC_SLASH, CC_BANG, CC_EQUAL,
+    CC_LESS, CC_GREATER, CC_AMP, CC_PIPE,
+    
+    CC_COUNT
+};
+
+// First class that starts an operator or delimiter
+constexpr uint8_t CC_FIRST_OPERATOR = CC_LPAREN;
+
+// Operator spellings in class order, starting at CC_FIRST_OPERATOR
+constexpr char operatorChars[] = "(){}[];,~^%+-*/!=<>&|";
+
+struct CharClassTable {
+    uint8_t classes[256];
+    
+    constexpr CharClassTable() : classes() {
+        for (int c = 'a'; c <= 'z'; c++) classes[c] = CC_ALPHA;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] = CC_ALPHA;
+        for (int c = '0'; c <= '9'; c++) classes[c] = CC_DIGIT;
+        classes['_'] = CC_ALPHA;
+        classes[' '] = CC_BLANK;
+        classes['\t'] = CC_BLANK;
+        classes['\r'] = CC_BLANK;
+        classes['\n'] = CC_NEWLINE;
+        classes['"'] = CC_QUOTE;
+        classes['#'] = CC_HASH;
+        for (int i = 0; operatorChars[i]; i++) {
+            classes[(unsigned char)operatorChars[i]] = CC_FIRST_OPERATOR + i;
+        }
+    }
+    
+    constexpr uint8_t operator[](char c) const { return classes[(unsigned char)c]; }
+};
+
+constexpr CharClassTable charClass;
+
+static_assert(sizeof(operatorChars) - 1 == CC_COUNT - CC_FIRST_OPERATOR, "operator class order");
+static_assert(charClass['|'] == CC_PIPE && charClass['('] == CC_LPAREN, "operator class order");
+
+// Locale-independent replacements for isdigit/isalpha/isalnum
+constexpr bool isDigitChar(char c) { return charClass[c] == CC_DIGIT; }
+constexpr bool isAlphaChar(char c) { return charClass[c] == CC_ALPHA; }
+constexpr bool isAlnumChar(char c) { return charClass[c] == CC_ALPHA || charClass[c] == CC_DIGIT; }
+
+// Operator DFA over character classes
+// State 0 is the start state. next[state][class] is the following state, or
+// 0 if the operator cannot be extended; accept[state] is the token to emit
+// when the DFA stops in that state (maximal munch).
+struct OperatorDfa {
+    static constexpr int MAX_STATES = 48;
+    
+    uint8_t next[MAX_STATES][CC_COUNT];
+    TokenType accept[MAX_STATES];
+    int stateCount;
+    
+    constexpr OperatorDfa() : next(), accept(), stateCount(1) {
+        add("(", LPAREN); add(")", RPAREN); add("{", LBRACE); add("}", RBRACE);
+        add("[", LBRACKET); add("]", RBRACKET); add(";", SEMICOLON); add(",", COMMA);
+        add("~", BITWISE_NOT); add("^", BITWISE_XOR); add("%", MODULO);
+        add("+", PLUS); add("++", INCREMENT); add("+=", PLUS_ASSIGN);
+        add("-", MINUS); add("--", DECREMENT); add("-=", MINUS_ASSIGN);
+        add("*", MULTIPLY); add("*=", MULT_ASSIGN);
+        add("/", DIVIDE); add("/=", DIV_ASSIGN);
+        add("!", NOT); add("!=", NEQ);
+        add("=", ASSIGN); add("==", EQ);
+        add("<", LT); add("<<", LEFT_SHIFT); add("<=", LTE);
+        add(">", GT); add(">>", RIGHT_SHIFT); add(">=", GTE);
+        add("&", BITWISE_AND); add("&&", AND);
+        add("|", BITWISE_OR); add("||", OR);
+    }
+    
+    // Add the path for one operator spelling, creating states as needed
+    constexpr void add(const char* spelling, TokenType type) {
+        int state = 0;
+        for (int i = 0; spelling[i]; i++) {
+            uint8_t cls = charClass[spelling[i]];
+            if (next[state][cls] == 0) {
+                accept[stateCount] = UNKNOWN;
+                next[state][cls] = stateCount++;
+            }
+            state = next[state][cls];
+        }
+        accept[state] = type;
+    }
+};
+
+constexpr OperatorDfa operatorDfa;
+
+#endif // CHAR_CLASS_H
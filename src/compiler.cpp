@@ -0,0 +1,610 @@
+#include "compiler.h"
+
+using namespace std;
+
+// Registers a frame can name (operands are 16 bits)
+static const uint32_t MAX_REGISTERS = 1 << 16;
+
+static bool isText(ValueType type) {
+    return type == ValueType::Text;
+}
+
+BytecodeCompiler::BytecodeCompiler(const Ast& tree, const Resolver& names, const TypeChecker& types,
+                                   const LineIndex& index)
+    : ast(tree), resolver(names), checker(types), lines(index), program(nullptr),
+      slots(tree.size() + 1, {0, false}), functionOf(tree.size() + 1, 0), entry(NO_NODE),
+      top(0), textTop(0), maxTop(0), maxTextTop(0), current(NO_NODE), atTopLevel(false),
+      result(ValueType::Void) {}
+
+void BytecodeCompiler::error(NodeId at, const string& message) {
+    const Node& node = ast.node(at);
+    SourcePosition position = lines.position(node.offset, node.length);
+    diagnostics.report(DiagnosticPhase::Codegen, position.line, position.column, message);
+}
+
+// Type of an expression, or declared type of a Declaration/Param
+ValueType BytecodeCompiler::typeOf(NodeId id) {
+    return checker.typeOf(id);
+}
+
+uint32_t BytecodeCompiler::allocate(ValueType type) {
+    if (isText(type)) {
+        maxTextTop = max(maxTextTop, textTop + 1);
+        return textTop++;
+    }
+    maxTop = max(maxTop, top + 1);
+    return top++;
+}
+
+void BytecodeCompiler::release(uint32_t mark, uint32_t textMark) {
+    top = mark;
+    textTop = textMark;
+}
+
+uint32_t BytecodeCompiler::emit(Opcode op, NodeId origin, uint32_t a, uint32_t b, uint32_t c) {
+    program->code.push_back({op, 0, (uint16_t)a, (uint16_t)b, (uint16_t)c});
+    program->origins.push_back(ast.node(origin).offset);
+    return program->code.size() - 1;
+}
+
+uint32_t BytecodeCompiler::emitWide(Opcode op, NodeId origin, uint32_t a, uint32_t k) {
+    return emit(op, origin, a, k & 0xFFFF, k >> 16);
+}
+
+// Point the jump at `at` to target
+void BytecodeCompiler::patch(uint32_t at, uint32_t target) {
+    program->code[at].b = target & 0xFFFF;
+    program->code[at].c = target >> 16;
+}
+
+uint32_t BytecodeCompiler::here() const {
+    return program->code.size();
+}
+
+uint32_t BytecodeCompiler::constant(Value value) {
+    program->constants.push_back(value);
+    return program->constants.size() - 1;
+}
+
+uint32_t BytecodeCompiler::text(string_view value) {
+    program->texts.emplace_back(value);
+    return program->texts.size() - 1;
+}
+
+// ==================== Program ====================
+
+bool BytecodeCompiler::compile(BytecodeProgram& output) {
+    program = &output;
+    program->texts.emplace_back();
+    program->functions.push_back({NO_NODE, "<start>", 0, 0, 0, ValueType::Void});
+    
+    // Every network gets a function, and so does the init() the resolver
+    // kept (any other was reported as a redefinition)
+    for (NodeId id = 1; id <= ast.size(); id++) {
+        const Node& node = ast.node(id);
+        if (node.kind == NodeKind::Network) {
+            functionOf[id] = program->functions.size();
+            program->functions.push_back({id, string(ast.text(id)), 0, 0, 0, typeOf(id)});
+        } else if (node.kind == NodeKind::Init && entry == NO_NODE) {
+            entry = id;
+            functionOf[id] = program->functions.size();
+            program->functions.push_back({id, "init", 0, 0, 0, typeOf(id)});
+        }
+    }
+    
+    startCode();
+    for (size_t f = 1; f < program->functions.size(); f++) {
+        function(program->functions[f].node);
+    }
+    return !hasError();
+}
+
+// Size the current function's frame once its code is complete
+void BytecodeCompiler::finishFunction(BytecodeFunction& compiled, NodeId at) {
+    compiled.registers = maxTop;
+    compiled.textRegisters = maxTextTop;
+    if (maxTop > MAX_REGISTERS || maxTextTop > MAX_REGISTERS) {
+        error(at, "'" + compiled.name + "' needs more than " + to_string(MAX_REGISTERS) + " registers");
+    }
+}
+
+// The top-level statements, then init()
+void BytecodeCompiler::startCode() {
+    BytecodeFunction& start = program->functions[0];
+    start.entry = here();
+    top = textTop = maxTop = maxTextTop = 0;
+    current = NO_NODE;
+    atTopLevel = true;
+    
+    NodeId root = ast.getRoot();
+    statements(ast.node(root).a);
+    atTopLevel = false;
+    
+    if (entry == NO_NODE) {
+        emit(Opcode::ReturnVoid, root);
+    } else {
+        start.result = typeOf(entry);
+        uint32_t value = allocate(start.result);
+        emitWide(isText(start.result) ? Opcode::CallText : Opcode::Call, entry, value, functionOf[entry]);
+        emit(Opcode::Args, entry, top, textTop);
+        if (start.result == ValueType::Void) emit(Opcode::ReturnVoid, entry);
+        else emit(isText(start.result) ? Opcode::ReturnText : Opcode::Return, entry, value);
+    }
+    finishFunction(start, root);
+}
+
+void BytecodeCompiler::function(NodeId id) {
+    const Node& node = ast.node(id);
+    BytecodeFunction& compiled = program->functions[functionOf[id]];
+    compiled.entry = here();
+    top = textTop = maxTop = maxTextTop = 0;
+    current = id;
+    result = compiled.result;
+    
+    if (result == ValueType::Unknown) {
+        error(id, "Cannot tell what '" + compiled.name + "' yields");
+    }
+    
+    // Parameters are the frame's first registers, in order
+    if (node.kind == NodeKind::Network) {
+        for (NodeId param = node.a; param != NO_NODE; param = ast.node(param).next) {
+            slots[param] = {allocate(typeOf(param)), false};
+        }
+    }
+    block(node.kind == NodeKind::Network ? node.b : node.a);
+    
+    // Falling off the end yields nothing, or a zero value
+    if (result == ValueType::Void) {
+        emit(Opcode::ReturnVoid, id);
+    } else {
+        uint32_t value = allocate(result);
+        loadZero(result, value, id);
+        emit(isText(result) ? Opcode::ReturnText : Opcode::Return, id, value);
+    }
+    finishFunction(compiled, id);
+}
+
+// ==================== Expressions ====================
+
+// Zero, 0.0, false or "" (a zero dnum has the bits of a zero cnum)
+void BytecodeCompiler::loadZero(ValueType type, uint32_t dest, NodeId origin) {
+    emitWide(isText(type) ? Opcode::LoadText : Opcode::LoadInt, origin, dest, 0);
+}
+
+// Register holding the value of an expression: a local variable's own
+// register, or a new temporary (freed by the caller's release)
+uint32_t BytecodeCompiler::operand(NodeId id) {
+    if (ast.node(id).kind == NodeKind::Identifier) {
+        NodeId declaration = resolver.declarationOf(id);
+        if (declaration != NO_NODE && !slots[declaration].global) return slots[declaration].index;
+    }
+    uint32_t value = allocate(typeOf(id));
+    expression(id, value);
+    return value;
+}
+
+uint32_t BytecodeCompiler::operandAs(NodeId id, ValueType type) {
+    ValueType from = typeOf(id);
+    if (from == type || isText(from) || isText(type)) return operand(id);
+    
+    uint32_t value = allocate(type);
+    expressionAs(id, type, value);
+    return value;
+}
+
+// Value of an expression converted to type (between dnum and cnum)
+void BytecodeCompiler::expressionAs(NodeId id, ValueType type, uint32_t dest) {
+    ValueType from = typeOf(id);
+    bool widen = type == ValueType::Cnum && from == ValueType::Dnum;
+    bool narrow = type == ValueType::Dnum && from == ValueType::Cnum;
+    if (!widen && !narrow) {
+        expression(id, dest);
+        return;
+    }
+    
+    // A dnum literal is stored as a cnum constant in the first place
+    if (widen && ast.node(id).kind == NodeKind::IntLiteral) {
+        Value value;
+        value.cnum = (double)ast.intValue(id);
+        emitWide(Opcode::LoadConst, id, dest, constant(value));
+        return;
+    }
+    
+    uint32_t mark = top, textMark = textTop;
+    uint32_t value = operand(id);
+    emit(widen ? Opcode::DnumToCnum : Opcode::CnumToDnum, id, dest, value);
+    release(mark, textMark);
+}
+
+// Compute an expression of its own type into dest. Every operand is read
+// before dest is written, so dest may be a variable the expression uses.
+void BytecodeCompiler::expression(NodeId id, uint32_t dest) {
+    const Node& node = ast.node(id);
+    
+    switch (node.kind) {
+        case NodeKind::IntLiteral: {
+            int64_t value = ast.intValue(id);
+            if (value == (int32_t)value) {
+                emitWide(Opcode::LoadInt, id, dest, (uint32_t)(int32_t)value);
+            } else {
+                Value wide;
+                wide.dnum = value;
+                emitWide(Opcode::LoadConst, id, dest, constant(wide));
+            }
+            break;
+        }
+        case NodeKind::FloatLiteral: {
+            Value value;
+            value.cnum = ast.floatValue(id);
+            emitWide(Opcode::LoadConst, id, dest, constant(value));
+            break;
+        }
+        case NodeKind::StringLiteral: {
+            string_view literal = ast.text(id);
+            emitWide(Opcode::LoadText, id, dest, text(literal.substr(1, literal.size() - 2)));
+            break;
+        }
+        case NodeKind::BoolLiteral:
+            emitWide(Opcode::LoadInt, id, dest, node.a);
+            break;
+        case NodeKind::Identifier: {
+            NodeId declaration = resolver.declarationOf(id);
+            bool text = isText(typeOf(id));
+            if (declaration == NO_NODE) break;
+            if (slots[declaration].global) {
+                emitWide(text ? Opcode::GetGlobalText : Opcode::GetGlobal, id, dest, slots[declaration].index);
+            } else if (slots[declaration].index != dest) {
+                emit(text ? Opcode::MoveText : Opcode::Move, id, dest, slots[declaration].index);
+            }
+            break;
+        }
+        case NodeKind::Call:
+            call(id, dest);
+            break;
+        case NodeKind::Unary:
+            unary(id, dest);
+            break;
+        case NodeKind::Binary:
+            binary(id, dest);
+            break;
+        default:
+            break;
+    }
+}
+
+// Arguments are computed straight into the registers the callee's frame
+// starts at, reserved above every live register before any is computed
+void BytecodeCompiler::call(NodeId id, uint32_t dest) {
+    const Node& node = ast.node(id);
+    NodeId network = resolver.declarationOf(id);
+    if (network == NO_NODE) {
+        error(id, "Network '" + string(ast.text(id)) + "' is in a linked module, which cannot be run");
+        return;
+    }
+    
+    // The resolver matched the lists, but the walk below relies on it
+    size_t arguments = 0, parameters = 0;
+    for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) arguments++;
+    for (NodeId param = ast.node(network).a; param != NO_NODE; param = ast.node(param).next) parameters++;
+    if (arguments != parameters) {
+        error(id, "Network '" + string(ast.text(id)) + "' expects " + to_string(parameters) +
+                  " arguments, got " + to_string(arguments));
+        return;
+    }
+    
+    uint32_t mark = top, textMark = textTop;
+    uint32_t base = top, textBase = textTop;
+    for (NodeId param = ast.node(network).a; param != NO_NODE; param = ast.node(param).next) {
+        allocate(typeOf(param));
+    }
+    
+    uint32_t next = base, nextText = textBase;
+    NodeId param = ast.node(network).a;
+    for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next, param = ast.node(param).next) {
+        ValueType type = typeOf(param);
+        expressionAs(arg, type, isText(type) ? nextText++ : next++);
+    }
+    
+    ValueType type = typeOf(network);
+    emitWide(isText(type) ? Opcode::CallText : Opcode::Call, id, dest, functionOf[network]);
+    emit(Opcode::Args, id, base, textBase);
+    release(mark, textMark);
+}
+
+void BytecodeCompiler::unary(NodeId id, uint32_t dest) {
+    const Node& node = ast.node(id);
+    bool real = typeOf(id) == ValueType::Cnum;
+    uint32_t mark = top, textMark = textTop;
+    
+    Opcode op;
+    switch (node.op) {
+        case NOT: op = Opcode::Not; break;
+        case BITWISE_NOT: op = Opcode::BitNot; break;
+        case INCREMENT: op = real ? Opcode::IncC : Opcode::IncD; break;
+        case DECREMENT: op = real ? Opcode::DecC : Opcode::DecD; break;
+        default: op = real ? Opcode::NegC : Opcode::NegD; break;
+    }
+    
+    // ++ and -- on a variable update it, as in C
+    NodeId variable = node.op == INCREMENT || node.op == DECREMENT ? node.a : NO_NODE;
+    NodeId declaration = NO_NODE;
+    if (variable != NO_NODE && ast.node(variable).kind == NodeKind::Identifier) {
+        declaration = resolver.declarationOf(variable);
+    }
+    
+    if (declaration == NO_NODE) {
+        emit(op, id, dest, operand(node.a));
+    } else if (slots[declaration].global) {
+        emitWide(Opcode::GetGlobal, id, dest, slots[declaration].index);
+        emit(op, id, dest, dest);
+        emitWide(Opcode::SetGlobal, id, dest, slots[declaration].index);
+    } else {
+        uint32_t local = slots[declaration].index;
+        emit(op, id, local, local);
+        if (local != dest) emit(Opcode::Move, id, dest, local);
+    }
+    release(mark, textMark);
+}
+
+void BytecodeCompiler::binary(NodeId id, uint32_t dest) {
+    const Node& node = ast.node(id);
+    if (node.op == AND || node.op == OR) {
+        logical(id, dest);
+        return;
+    }
+    
+    // Mixed dnum and cnum operands are both taken as cnums
+    ValueType left = typeOf(node.a);
+    ValueType right = typeOf(node.b);
+    ValueType type = left == ValueType::Cnum || right == ValueType::Cnum ? ValueType::Cnum : left;
+    bool real = type == ValueType::Cnum;
+    bool text = isText(type);
+    uint32_t mark = top, textMark = textTop;
+    
+    // x + 1 and x - 1 on dnums, the usual loop step, take one register
+    const Node& rightNode = ast.node(node.b);
+    if ((node.op == PLUS || node.op == MINUS) && type == ValueType::Dnum &&
+        rightNode.kind == NodeKind::IntLiteral && ast.intValue(node.b) == 1) {
+        emit(node.op == PLUS ? Opcode::IncD : Opcode::DecD, id, dest, operand(node.a));
+        release(mark, textMark);
+        return;
+    }
+    
+    // A variable on the left is read before a ++ or -- on the right runs
+    uint32_t b;
+    if (ast.node(node.a).kind == NodeKind::Identifier && updatesVariable(node.b)) {
+        b = allocate(type);
+        expressionAs(node.a, type, b);
+    } else {
+        b = operandAs(node.a, type);
+    }
+    uint32_t c = operandAs(node.b, type);
+    
+    Opcode op;
+    bool swap = false;
+    switch (node.op) {
+        case PLUS: op = text ? Opcode::Concat : real ? Opcode::AddC : Opcode::AddD; break;
+        case MINUS: op = real ? Opcode::SubC : Opcode::SubD; break;
+        case MULTIPLY: op = real ? Opcode::MulC : Opcode::MulD; break;
+        case DIVIDE: op = real ? Opcode::DivC : Opcode::DivD; break;
+        case MODULO: op = Opcode::ModD; break;
+        case BITWISE_AND: op = Opcode::BitAnd; break;
+        case BITWISE_OR: op = Opcode::BitOr; break;
+        case BITWISE_XOR: op = Opcode::BitXor; break;
+        case LEFT_SHIFT: op = Opcode::ShiftLeft; break;
+        case RIGHT_SHIFT: op = Opcode::ShiftRight; break;
+        case EQ: op = text ? Opcode::EqText : real ? Opcode::EqC : Opcode::EqD; break;
+        case NEQ: op = text ? Opcode::NeText : real ? Opcode::NeC : Opcode::NeD; break;
+        case LT: op = real ? Opcode::LtC : Opcode::LtD; break;
+        case LTE: op = real ? Opcode::LeC : Opcode::LeD; break;
+        case GT: op = real ? Opcode::LtC : Opcode::LtD; swap = true; break;
+        default: op = real ? Opcode::LeC : Opcode::LeD; swap = true; break;     // GTE
+    }
+    emit(op, id, dest, swap ? c : b, swap ? b : c);
+    release(mark, textMark);
+}
+
+// Whether evaluating an expression runs a ++ or --
+bool BytecodeCompiler::updatesVariable(NodeId id) const {
+    vector<NodeId> pending;
+    if (id != NO_NODE) pending.push_back(id);
+    
+    while (!pending.empty()) {
+        const Node& node = ast.node(pending.back());
+        pending.pop_back();
+        switch (node.kind) {
+            case NodeKind::Unary:
+                if (node.op == INCREMENT || node.op == DECREMENT) return true;
+                pending.push_back(node.a);
+                break;
+            case NodeKind::Binary:
+                pending.push_back(node.a);
+                pending.push_back(node.b);
+                break;
+            case NodeKind::Call:
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) pending.push_back(arg);
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+// && and || skip their right operand when the left one decides. dest is
+// only written once the operands have been read, on both paths.
+void BytecodeCompiler::logical(NodeId id, uint32_t dest) {
+    const Node& node = ast.node(id);
+    bool isAnd = node.op == AND;
+    
+    uint32_t mark = top, textMark = textTop;
+    uint32_t decided = emitWide(isAnd ? Opcode::JumpIfFalse : Opcode::JumpIfTrue, id, operand(node.a), 0);
+    release(mark, textMark);
+    
+    expression(node.b, dest);
+    uint32_t done = emitWide(Opcode::Jump, id, 0, 0);
+    patch(decided, here());
+    emitWide(Opcode::LoadInt, id, dest, isAnd ? 0 : 1);
+    patch(done, here());
+}
+
+// Jump taken when a condition is `when`; returns it to be patched
+uint32_t BytecodeCompiler::branch(NodeId condition, bool when) {
+    // !x jumps on x instead
+    while (ast.node(condition).kind == NodeKind::Unary && ast.node(condition).op == NOT) {
+        condition = ast.node(condition).a;
+        when = !when;
+    }
+    
+    uint32_t mark = top, textMark = textTop;
+    uint32_t at = emitWide(when ? Opcode::JumpIfTrue : Opcode::JumpIfFalse, condition, operand(condition), 0);
+    release(mark, textMark);
+    return at;
+}
+
+// ==================== Statements ====================
+
+// A nested statement list, whose variables are freed at its end
+void BytecodeCompiler::block(NodeId first) {
+    uint32_t mark = top, textMark = textTop;
+    bool outer = atTopLevel;
+    atTopLevel = false;
+    statements(first);
+    atTopLevel = outer;
+    release(mark, textMark);
+}
+
+void BytecodeCompiler::statements(NodeId first) {
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) {
+        statement(id);
+    }
+}
+
+void BytecodeCompiler::statement(NodeId id) {
+    const Node& node = ast.node(id);
+    uint32_t mark = top, textMark = textTop;
+    
+    switch (node.kind) {
+        case NodeKind::Declaration:
+            declaration(id);
+            break;
+        case NodeKind::Assign:
+            store(id, node.a);
+            break;
+        case NodeKind::Feed: {
+            NodeId declaration = resolver.declarationOf(id);
+            ValueType type = typeOf(declaration);
+            Opcode op = type == ValueType::Cnum ? Opcode::FeedC :
+                        type == ValueType::Flag ? Opcode::FeedFlag :
+                        type == ValueType::Text ? Opcode::FeedText : Opcode::FeedD;
+            if (slots[declaration].global) {
+                uint32_t value = allocate(type);
+                emit(op, id, value);
+                emitWide(isText(type) ? Opcode::SetGlobalText : Opcode::SetGlobal, id, value,
+                         slots[declaration].index);
+                release(mark, textMark);
+            } else {
+                emit(op, id, slots[declaration].index);
+            }
+            break;
+        }
+        case NodeKind::Forward: {
+            ValueType type = typeOf(node.a);
+            Opcode op = type == ValueType::Cnum ? Opcode::ForwardC :
+                        type == ValueType::Flag ? Opcode::ForwardFlag :
+                        type == ValueType::Text ? Opcode::ForwardText : Opcode::ForwardD;
+            emit(op, id, operand(node.a));
+            release(mark, textMark);
+            break;
+        }
+        case NodeKind::Yield:
+            // A yield outside any network ends the program without a result
+            if (current == NO_NODE) {
+                operand(node.a);
+                emit(Opcode::ReturnVoid, id);
+            } else {
+                emit(isText(result) ? Opcode::ReturnText : Opcode::Return, id, operandAs(node.a, result));
+            }
+            release(mark, textMark);
+            break;
+        case NodeKind::If: {
+            uint32_t skipThen = branch(node.a, false);
+            block(node.b);
+            if (node.c == NO_NODE) {
+                patch(skipThen, here());
+                break;
+            }
+            uint32_t skipElse = emitWide(Opcode::Jump, id, 0, 0);
+            patch(skipThen, here());
+            block(node.c);
+            patch(skipElse, here());
+            break;
+        }
+        case NodeKind::Until: {
+            // Runs while the condition is false, tested before each pass
+            uint32_t toTest = emitWide(Opcode::Jump, id, 0, 0);
+            uint32_t body = here();
+            block(node.b);
+            patch(toTest, here());
+            patch(branch(node.a, false), body);
+            break;
+        }
+        case NodeKind::Iterate: {
+            // As C's for: the header's variable lives until the loop ends
+            bool outer = atTopLevel;
+            atTopLevel = false;
+            if (node.a != NO_NODE) declaration(node.a);
+            uint32_t toTest = emitWide(Opcode::Jump, id, 0, 0);
+            uint32_t body = here();
+            block(node.d);
+            if (node.c != NO_NODE) store(node.c, ast.node(node.c).a);
+            patch(toTest, here());
+            if (node.b != NO_NODE) patch(branch(node.b, true), body);
+            else emitWide(Opcode::Jump, id, 0, body);
+            atTopLevel = outer;
+            release(mark, textMark);
+            break;
+        }
+        default:
+            // Networks and init() are compiled on their own; links need no code
+            break;
+    }
+}
+
+void BytecodeCompiler::declaration(NodeId id) {
+    const Node& node = ast.node(id);
+    ValueType type = typeOf(id);
+    
+    if (atTopLevel) {
+        uint32_t global = isText(type) ? program->textGlobals++ : program->globals++;
+        slots[id] = {global, true};
+        if (node.a != NO_NODE) {
+            uint32_t mark = top, textMark = textTop;
+            emitWide(isText(type) ? Opcode::SetGlobalText : Opcode::SetGlobal, id, operandAs(node.a, type), global);
+            release(mark, textMark);
+        }
+        return;
+    }
+    
+    // The initializer cannot see the variable, so it may be computed
+    // straight into the variable's register
+    uint32_t local = allocate(type);
+    if (node.a != NO_NODE) expressionAs(node.a, type, local);
+    else loadZero(type, local, id);
+    slots[id] = {local, false};
+}
+
+// Assign value to the variable target (an Assign node) refers to
+void BytecodeCompiler::store(NodeId target, NodeId value) {
+    NodeId declaration = resolver.declarationOf(target);
+    ValueType type = typeOf(declaration);
+    
+    if (!slots[declaration].global) {
+        expressionAs(value, type, slots[declaration].index);
+        return;
+    }
+    uint32_t mark = top, textMark = textTop;
+    emitWide(isText(type) ? Opcode::SetGlobalText : Opcode::SetGlobal, target, operandAs(value, type),
+             slots[declaration].index);
+    release(mark, textMark);
+}
@@ -0,0 +1,94 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "diagnostics.h"
+#include "line_index.h"
+#include "resolver.h"
+#include "type_checker.h"
+
+using namespace std;
+
+// BytecodeCompiler - translates a checked program into register bytecode
+// Every operation is picked by the types the checker inferred (ADD_D or
+// ADD_C, EQ_TEXT, ...), with explicit conversions where a dnum meets a cnum,
+// so the VM never looks at a type. Top-level variables become globals;
+// every other variable gets a register of its frame for its scope's
+// lifetime, and temporaries are allocated above the live variables like a
+// stack. Loops are laid out with their test at the bottom, so an iteration
+// costs one conditional jump. Expressions are compiled recursively, which
+// the checker's limit on their nesting keeps within the native stack.
+class BytecodeCompiler {
+private:
+    // Where a variable lives
+    struct Slot {
+        uint32_t index;     // Register, or global number
+        bool global;
+    };
+    
+    const Ast& ast;
+    const Resolver& resolver;
+    const TypeChecker& checker;
+    const LineIndex& lines;
+    Diagnostics diagnostics;
+    
+    BytecodeProgram* program;
+    vector<Slot> slots;             // By Declaration/Param node
+    vector<uint32_t> functionOf;    // By Network/Init node: index in functions
+    NodeId entry;                   // The init() that runs
+    uint32_t top, textTop;          // Next free register of each bank
+    uint32_t maxTop, maxTextTop;    // Registers the frame needs
+    NodeId current;                 // Network/Init being compiled (NO_NODE: start code)
+    bool atTopLevel;                // Declarations are globals (top-level list)
+    ValueType result;               // What the current function yields
+    
+    void error(NodeId at, const string& message);
+    ValueType typeOf(NodeId id);
+    uint32_t allocate(ValueType type);
+    void release(uint32_t mark, uint32_t textMark);
+    uint32_t emit(Opcode op, NodeId origin, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    uint32_t emitWide(Opcode op, NodeId origin, uint32_t a, uint32_t k);
+    void patch(uint32_t at, uint32_t target);
+    uint32_t here() const;
+    uint32_t constant(Value value);
+    uint32_t text(string_view value);
+    
+    void loadZero(ValueType type, uint32_t dest, NodeId origin);
+    uint32_t operand(NodeId id);
+    uint32_t operandAs(NodeId id, ValueType type);
+    void expressionAs(NodeId id, ValueType type, uint32_t dest);
+    void expression(NodeId id, uint32_t dest);
+    void call(NodeId id, uint32_t dest);
+    void unary(NodeId id, uint32_t dest);
+    void binary(NodeId id, uint32_t dest);
+    void logical(NodeId id, uint32_t dest);
+    uint32_t branch(NodeId condition, bool when);
+    bool updatesVariable(NodeId id) const;
+    
+    void finishFunction(BytecodeFunction& compiled, NodeId at);
+    void function(NodeId id);
+    void startCode();
+    void block(NodeId first);
+    void statements(NodeId first);
+    void statement(NodeId id);
+    void declaration(NodeId id);
+    void store(NodeId target, NodeId value);
+    
+public:
+    // The checker must have checked ast without errors
+    BytecodeCompiler(const Ast& ast, const Resolver& resolver, const TypeChecker& checker,
+                     const LineIndex& lines);
+    
+    // Compile the whole program into program; false on errors (calls to
+    // linked networks, which are not compiled, or frames too large)
+    bool compile(BytecodeProgram& program);
+    
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    bool hasError() const { return !diagnostics.empty(); }
+};
+
+#endif // COMPILER_H
@@ -0,0 +1,351 @@
+#include "constant_folder.h"
+#include <algorithm>
+#include "runtime.h"
+
+using namespace std;
+
+ConstantFolder::ConstantFolder(Ast& tree) : ast(tree), folded(0), branches(0), removed(0) {}
+
+void ConstantFolder::fold() {
+    Node& root = ast.node(ast.getRoot());
+    root.a = statements(root.a);
+}
+
+// ==================== Counting ====================
+
+// Empty sizing, counting the nodes of the trees on it. Lists can nest as
+// deep as expressions do, so every child goes on the stack.
+size_t ConstantFolder::countSizing() {
+    size_t size = 0;
+    while (!sizing.empty()) {
+        NodeId id = sizing.back();
+        sizing.pop_back();
+        if (id == NO_NODE) continue;
+        const Node& node = ast.node(id);
+        size++;
+        switch (node.kind) {
+            case NodeKind::Declaration:
+            case NodeKind::Assign:
+            case NodeKind::Forward:
+            case NodeKind::Yield:
+            case NodeKind::Unary:
+                sizing.push_back(node.a);
+                break;
+            case NodeKind::Binary:
+                sizing.push_back(node.a);
+                sizing.push_back(node.b);
+                break;
+            case NodeKind::Call:
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) sizing.push_back(arg);
+                break;
+            case NodeKind::If:
+                sizing.push_back(node.a);
+                for (NodeId child = node.b; child != NO_NODE; child = ast.node(child).next) sizing.push_back(child);
+                for (NodeId child = node.c; child != NO_NODE; child = ast.node(child).next) sizing.push_back(child);
+                break;
+            case NodeKind::Until:
+                sizing.push_back(node.a);
+                for (NodeId child = node.b; child != NO_NODE; child = ast.node(child).next) sizing.push_back(child);
+                break;
+            case NodeKind::Iterate:
+                sizing.push_back(node.a);
+                sizing.push_back(node.b);
+                sizing.push_back(node.c);
+                for (NodeId child = node.d; child != NO_NODE; child = ast.node(child).next) sizing.push_back(child);
+                break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+// Nodes of the tree under id, itself included (not its next siblings)
+size_t ConstantFolder::subtreeSize(NodeId id) {
+    sizing.push_back(id);
+    return countSizing();
+}
+
+size_t ConstantFolder::listSize(NodeId first) {
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) sizing.push_back(id);
+    return countSizing();
+}
+
+// ==================== Expressions ====================
+
+bool ConstantFolder::isNumber(NodeId id) const {
+    NodeKind kind = ast.node(id).kind;
+    return kind == NodeKind::IntLiteral || kind == NodeKind::FloatLiteral;
+}
+
+// Turn the operator node id into a literal of kind, dropping its operands
+void ConstantFolder::replace(NodeId id, NodeKind kind) {
+    Node& node = ast.node(id);
+    removed += subtreeSize(id) - 1;
+    folded++;
+    node.kind = kind;
+    node.op = 0;
+    node.count = 0;
+    node.a = node.b = node.c = node.d = NO_NODE;
+}
+
+void ConstantFolder::makeInt(NodeId id, int64_t value) {
+    replace(id, NodeKind::IntLiteral);
+    ast.setInt(id, value);
+}
+
+void ConstantFolder::makeFloat(NodeId id, double value) {
+    replace(id, NodeKind::FloatLiteral);
+    ast.setFloat(id, value);
+}
+
+void ConstantFolder::makeFlag(NodeId id, bool value) {
+    replace(id, NodeKind::BoolLiteral);
+    ast.node(id).a = value ? 1 : 0;
+}
+
+// Fold the expression id; returns what takes its place (id itself unless
+// it is reduced to one of its operands). Operands are folded first, on an
+// explicit stack; each leaves what replaces it on replacements, where its
+// operator finds them in order and links them in.
+NodeId ConstantFolder::expression(NodeId id) {
+    pending.clear();
+    replacements.clear();
+    pending.push_back({id, false});
+    
+    while (!pending.empty()) {
+        NodeId current = pending.back().first;
+        bool operandsDone = pending.back().second;
+        pending.pop_back();
+        Node& node = ast.node(current);
+        
+        switch (node.kind) {
+            case NodeKind::Call: {
+                if (!operandsDone) {
+                    pending.push_back({current, true});
+                    size_t firstArg = pending.size();
+                    for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) {
+                        pending.push_back({arg, false});
+                    }
+                    reverse(pending.begin() + firstArg, pending.end());
+                    break;
+                }
+                // The original arguments still link to each other
+                size_t args = 0;
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) args++;
+                size_t firstArg = replacements.size() - args;
+                NodeId* link = &node.a;
+                for (size_t i = firstArg; i < replacements.size(); i++) {
+                    *link = replacements[i];
+                    link = &ast.node(*link).next;
+                }
+                *link = NO_NODE;
+                replacements.resize(firstArg);
+                replacements.push_back(current);
+                break;
+            }
+            case NodeKind::Unary:
+                if (!operandsDone) {
+                    pending.push_back({current, true});
+                    pending.push_back({node.a, false});
+                    break;
+                }
+                node.a = replacements.back();
+                replacements.pop_back();
+                unary(current);
+                replacements.push_back(current);
+                break;
+            case NodeKind::Binary: {
+                if (!operandsDone) {
+                    pending.push_back({current, true});
+                    pending.push_back({node.b, false});
+                    pending.push_back({node.a, false});
+                    break;
+                }
+                node.b = replacements.back();
+                replacements.pop_back();
+                node.a = replacements.back();
+                replacements.pop_back();
+                replacements.push_back(binary(current));
+                break;
+            }
+            default:
+                replacements.push_back(current);
+                break;
+        }
+    }
+    return replacements.back();
+}
+
+void ConstantFolder::unary(NodeId id) {
+    const Node& node = ast.node(id);
+    const Node& operand = ast.node(node.a);
+    
+    if (operand.kind == NodeKind::BoolLiteral) {
+        if (node.op == NOT) makeFlag(id, operand.a == 0);
+    }
+    else if (operand.kind == NodeKind::IntLiteral) {
+        int64_t value = ast.intValue(node.a);
+        switch (node.op) {
+            case BITWISE_NOT: makeInt(id, ~value); break;
+            case INCREMENT: makeInt(id, wrapAdd(value, 1)); break;
+            case DECREMENT: makeInt(id, wrapSub(value, 1)); break;
+            default: makeInt(id, wrapNeg(value)); break;      // MINUS
+        }
+    }
+    else if (operand.kind == NodeKind::FloatLiteral) {
+        double value = ast.floatValue(node.a);
+        switch (node.op) {
+            case INCREMENT: makeFloat(id, value + 1); break;
+            case DECREMENT: makeFloat(id, value - 1); break;
+            default: makeFloat(id, -value); break;          // MINUS
+        }
+    }
+}
+
+// Returns what takes the place of the binary node id
+NodeId ConstantFolder::binary(NodeId id) {
+    const Node& node = ast.node(id);
+    const Node& left = ast.node(node.a);
+    const Node& right = ast.node(node.b);
+    
+    // A literal left operand of && or || either decides the result or
+    // leaves it to the right one
+    if (node.op == AND || node.op == OR) {
+        if (left.kind != NodeKind::BoolLiteral) return id;
+        if ((left.a != 0) == (node.op == OR)) {
+            makeFlag(id, left.a != 0);
+            return id;
+        }
+        NodeId kept = node.b;
+        removed += 2;
+        folded++;
+        return kept;
+    }
+    
+    if (left.kind == NodeKind::BoolLiteral && right.kind == NodeKind::BoolLiteral) {
+        makeFlag(id, (left.a == right.a) == (node.op == EQ));      // EQ or NEQ
+        return id;
+    }
+    if (!isNumber(node.a) || !isNumber(node.b)) return id;
+    
+    // Mixed dnum and cnum operands are both taken as cnums
+    if (left.kind == NodeKind::FloatLiteral || right.kind == NodeKind::FloatLiteral) {
+        double a = left.kind == NodeKind::FloatLiteral ? ast.floatValue(node.a) : (double)ast.intValue(node.a);
+        double b = right.kind == NodeKind::FloatLiteral ? ast.floatValue(node.b) : (double)ast.intValue(node.b);
+        switch (node.op) {
+            case EQ: makeFlag(id, a == b); break;
+            case NEQ: makeFlag(id, a != b); break;
+            case LT: makeFlag(id, a < b); break;
+            case GT: makeFlag(id, a > b); break;
+            case LTE: makeFlag(id, a <= b); break;
+            case GTE: makeFlag(id, a >= b); break;
+            case PLUS: makeFloat(id, a + b); break;
+            case MINUS: makeFloat(id, a - b); break;
+            case MULTIPLY: makeFloat(id, a * b); break;
+            case DIVIDE: makeFloat(id, a / b); break;
+            default: break;
+        }
+        return id;
+    }
+    
+    int64_t a = ast.intValue(node.a);
+    int64_t b = ast.intValue(node.b);
+    switch (node.op) {
+        case EQ: makeFlag(id, a == b); break;
+        case NEQ: makeFlag(id, a != b); break;
+        case LT: makeFlag(id, a < b); break;
+        case GT: makeFlag(id, a > b); break;
+        case LTE: makeFlag(id, a <= b); break;
+        case GTE: makeFlag(id, a >= b); break;
+        case PLUS: makeInt(id, wrapAdd(a, b)); break;
+        case MINUS: makeInt(id, wrapSub(a, b)); break;
+        case MULTIPLY: makeInt(id, wrapMul(a, b)); break;
+        case DIVIDE: if (b != 0) makeInt(id, wrapDiv(a, b)); break;
+        case MODULO: if (b != 0) makeInt(id, wrapMod(a, b)); break;
+        case BITWISE_AND: makeInt(id, a & b); break;
+        case BITWISE_OR: makeInt(id, a | b); break;
+        case BITWISE_XOR: makeInt(id, a ^ b); break;
+        case LEFT_SHIFT: makeInt(id, shiftLeft(a, b)); break;
+        case RIGHT_SHIFT: makeInt(id, shiftRight(a, b)); break;
+        default: break;
+    }
+    return id;
+}
+
+// ==================== Statements ====================
+
+// Fold a statement list; returns its new first statement
+NodeId ConstantFolder::statements(NodeId first) {
+    NodeId head = NO_NODE, tail = NO_NODE;
+    NodeId id = first;
+    while (id != NO_NODE) {
+        NodeId next = ast.node(id).next;
+        ast.node(id).next = NO_NODE;
+        
+        // A statement is replaced by a list of any length
+        NodeId kept = statement(id);
+        if (kept != NO_NODE) {
+            if (tail == NO_NODE) head = kept;
+            else ast.node(tail).next = kept;
+            tail = kept;
+            while (ast.node(tail).next != NO_NODE) tail = ast.node(tail).next;
+        }
+        id = next;
+    }
+    return head;
+}
+
+// Fold the statement id; returns the list that takes its place
+NodeId ConstantFolder::statement(NodeId id) {
+    Node& node = ast.node(id);
+    switch (node.kind) {
+        case NodeKind::Network:
+            node.b = statements(node.b);
+            return id;
+        case NodeKind::Init:
+            node.a = statements(node.a);
+            return id;
+        case NodeKind::Declaration:
+        case NodeKind::Assign:
+        case NodeKind::Forward:
+        case NodeKind::Yield:
+            if (node.a != NO_NODE) node.a = expression(node.a);
+            return id;
+        case NodeKind::If: {
+            node.a = expression(node.a);
+            const Node& condition = ast.node(node.a);
+            if (condition.kind != NodeKind::BoolLiteral) {
+                node.b = statements(node.b);
+                node.c = statements(node.c);
+                return id;
+            }
+            
+            // Names are already bound, so the arm's statements can join
+            // the enclosing list
+            NodeId taken = condition.a ? node.b : node.c;
+            removed += 2 + listSize(condition.a ? node.c : node.b);
+            branches++;
+            return statements(taken);
+        }
+        case NodeKind::Until: {
+            node.a = expression(node.a);
+            const Node& condition = ast.node(node.a);
+            if (condition.kind == NodeKind::BoolLiteral && condition.a) {
+                removed += subtreeSize(id);
+                branches++;
+                return NO_NODE;
+            }
+            node.b = statements(node.b);
+            return id;
+        }
+        case NodeKind::Iterate:
+            if (node.a != NO_NODE) statement(node.a);
+            if (node.b != NO_NODE) node.b = expression(node.b);
+            if (node.c != NO_NODE) statement(node.c);
+            node.d = statements(node.d);
+            return id;
+        default:
+            return id;
+    }
+}
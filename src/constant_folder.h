@@ -0,0 +1,66 @@
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ast.h"
+
+using namespace std;
+
+// ConstantFolder - evaluates what a checked program computes from literals alone
+// Arithmetic, bitwise, comparison and logical operators whose operands are
+// int, float or bool literals become the literal they compute, with the
+// execution engines' semantics (see runtime.h); && and || with a literal
+// left operand keep only what they would evaluate. Dividing a dnum by
+// zero is left for run time to report. An if whose condition folds to a
+// literal is replaced by the statements of the arm it takes (names are
+// already bound, so they may join the enclosing list), and an until whose
+// condition folds to true (its body never runs) is dropped.
+// The tree is rewritten in place in one bottom-up pass: a folded operator
+// node becomes the literal, so it keeps its id and with it the type the
+// checker gave it. The removed nodes stay in the arena, unlinked.
+// Expressions are walked, and removed subtrees counted, with explicit
+// stacks, so no operator chain can overflow the native one.
+// Removed branches are not checked again, so only fold a checked tree.
+class ConstantFolder {
+private:
+    Ast& ast;
+    size_t folded;          // Expressions replaced by a literal or an operand
+    size_t branches;        // If arms and until loops removed
+    size_t removed;         // Nodes unlinked from the tree
+    vector<pair<NodeId, bool>> pending; // Expression walk: node, operands done
+    vector<NodeId> replacements;    // Expression walk: what takes the place of
+                                    // each folded operand, in order
+    vector<NodeId> sizing;          // Subtrees left to count
+    
+    size_t countSizing();
+    size_t subtreeSize(NodeId id);
+    size_t listSize(NodeId first);
+    
+    bool isNumber(NodeId id) const;
+    void replace(NodeId id, NodeKind kind);
+    void makeInt(NodeId id, int64_t value);
+    void makeFloat(NodeId id, double value);
+    void makeFlag(NodeId id, bool value);
+    
+    NodeId expression(NodeId id);
+    void unary(NodeId id);
+    NodeId binary(NodeId id);
+    
+    NodeId statements(NodeId first);
+    NodeId statement(NodeId id);
+    
+public:
+    // The checker must have checked ast without errors
+    explicit ConstantFolder(Ast& ast);
+    
+    // Fold the whole tree (once)
+    void fold();
+    
+    size_t foldedCount() const { return folded; }
+    size_t branchCount() const { return branches; }
+    size_t removedCount() const { return removed; }
+};
+
+#endif // CONSTANT_FOLDER_H
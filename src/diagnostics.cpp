@@ -0,0 +1,50 @@
+#include "diagnostics.h"
+
+using namespace std;
+
+void Diagnostics::report(DiagnosticPhase phase, int line, int column, 
+                         const string& message, const string& found) {
+    entries.push_back({phase, line, column, message, found});
+}
+
+void Diagnostics::append(const Diagnostics& other) {
+    entries.insert(entries.end(), other.entries.begin(), other.entries.end());
+}
+
+string Diagnostics::render(const string& prefix) const {
+    string out;
+    for (const Diagnostic& entry : entries) {
+        out += prefix;
+        if (entry.phase == DiagnosticPhase::Driver) {
+            out += "Error: " + entry.message + "\n";
+        } else if (entry.phase == DiagnosticPhase::Scanner) {
+            out += "Error: " + entry.message + " at line " + to_string(entry.line);
+            if (entry.column > 0) out += ", column " + to_string(entry.column);
+            out += "\n";
+        } else if (entry.phase == DiagnosticPhase::Linker) {
+            out += "Link Error at line " + to_string(entry.line) + ", column " + 
+                   to_string(entry.column) + ": " + entry.message + "\n";
+        } else if (entry.phase == DiagnosticPhase::Semantic) {
+            out += "Semantic Error at line " + to_string(entry.line) + ", column " + 
+                   to_string(entry.column) + ": " + entry.message + "\n";
+        } else if (entry.phase == DiagnosticPhase::Codegen) {
+            out += "Code Generation Error at line " + to_string(entry.line) + ", column " + 
+                   to_string(entry.column) + ": " + entry.message + "\n";
+        } else if (entry.phase == DiagnosticPhase::Runtime) {
+            out += "Runtime Error at line " + to_string(entry.line) + ", column " + 
+                   to_string(entry.column) + ": " + entry.message + "\n";
+        } else {
+            out += "Parse Error at line " + to_string(entry.line) + ", column " + 
+                   to_string(entry.column) + ": " + entry.message + "\n";
+            if (!entry.found.empty()) out += "  Found: " + entry.found + "\n";
+        }
+    }
+    return out;
+}
+
+void Diagnostics::flush(FILE* out) const {
+    if (entries.empty()) return;
+    string text = render();
+    fwrite(text.data(), 1, text.size(), out);
+    fflush(out);
+}
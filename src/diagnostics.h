@@ -0,0 +1,57 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Compiler phase that produced a diagnostic
+enum class DiagnosticPhase {
+    Driver,         // Problems with the input itself (missing file, ...)
+    Scanner,
+    Parser,
+    Linker,         // Link statements that cannot be resolved
+    Semantic,       // Names that do not resolve, calls that do not match
+    Codegen,        // Programs that type check but cannot be compiled to run
+    Runtime         // Faults of a running program (division by zero, ...)
+};
+
+// One error report
+struct Diagnostic {
+    DiagnosticPhase phase;
+    int line;               // 1-based line of the error
+    int column;             // 1-based column, or 0 if not reported
+    string message;         // What went wrong
+    string found;           // Offending token ("TYPE ('lexeme')"), may be empty
+};
+
+// Diagnostics - errors collected during a phase
+// Reports are kept in memory in the order they were made and written out
+// together, so error paths never flush a stream mid-scan or mid-parse.
+class Diagnostics {
+private:
+    vector<Diagnostic> entries;
+    
+public:
+    void report(DiagnosticPhase phase, int line, int column, 
+                const string& message, const string& found = "");
+    
+    // Add all entries of another list after the current ones
+    void append(const Diagnostics& other);
+    
+    const vector<Diagnostic>& list() const { return entries; }
+    size_t count() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() { entries.clear(); }
+    
+    // Format every entry, one per line (two with a found token); a
+    // non-empty prefix (such as "file.netc: ") starts each entry
+    string render(const string& prefix = "") const;
+    
+    // Write all entries with a single write call
+    void flush(FILE* out) const;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,222 @@
+#include "edit_session.h"
+#include <algorithm>
+#include "parser.h"
+
+using namespace std;
+
+// Open a session: scan the whole text, then parse every definition
+EditSession::EditSession(const string& text, ScanMode scanMode)
+    : source(text), mode(scanMode), unterminated(false) {
+    Scanner scanner(source, mode);
+    scanner.scanRange(0, source.size(), nullptr);
+    
+    tokens.reset(source);
+    tokens.types.swap(scanner.buffer.types);
+    tokens.offsets.swap(scanner.buffer.offsets);
+    tokens.lengths.swap(scanner.buffer.lengths);
+    tokens.symbols.swap(scanner.buffer.symbols);
+    tokens.count = tokens.types.size();
+    tokens.push(END_OF_FILE, source.size(), 0);
+    internTokens(0, tokens.size());
+    
+    for (uint32_t newline : scanner.lines.stringNewlineOffsets()) tokens.lines.addStringNewline(newline);
+    tokens.lines.lineStarts();
+    unknownSites = scanner.unknownSites;
+    unterminated = scanner.unterminated;
+    
+    size_t end = tokens.size() - 1;
+    definitions.resize(1);
+    definitions[0].first = 0;
+    for (size_t i = Parser::nextTopLevelStart(tokens, 0, end); i < end;
+         i = Parser::nextTopLevelStart(tokens, i + 1, end)) {
+        if (i == 0) continue;
+        definitions.emplace_back();
+        definitions.back().first = i;
+    }
+    for (size_t i = 0; i < definitions.size(); i++) {
+        parseDefinition(definitions[i], definitionEnd(i));
+    }
+}
+
+// Token index just past definition index (its END_OF_FILE stand-in)
+size_t EditSession::definitionEnd(size_t index) const {
+    return index + 1 < definitions.size() ? definitions[index + 1].first : tokens.size() - 1;
+}
+
+// Set the symbols of the identifiers among tokens [first, last), which
+// the scanner left uninterned
+void EditSession::internTokens(size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+        if (tokens.type(i) == IDENTIFIER) tokens.symbols[i] = interner.intern(tokens.lexeme(i));
+    }
+}
+
+void EditSession::parseDefinition(Definition& definition, size_t last) {
+    Parser parser(tokens, definition.first, last);
+    parser.ast.reset(source, (last - definition.first) / 2);
+    parser.ast.setRoot(parser.program());
+    
+    definition.parsedOffset = tokens.offset(definition.first);
+    definition.parsedLine = tokens.lines.lineOf(definition.parsedOffset);
+    definition.ast = move(parser.ast);
+    definition.diagnostics = move(parser.diagnostics);
+    definition.hadError = parser.hadError;
+    stats.definitionsParsed++;
+}
+
+// ==================== Editing ====================
+
+void EditSession::edit(size_t offset, size_t length, string_view replacement) {
+    stats = EditStats();
+    offset = min(offset, source.size());
+    length = min(length, source.size() - offset);
+    size_t editEnd = offset + length;
+    int64_t delta = (int64_t)replacement.size() - (int64_t)length;
+    
+    // Restart at a token whose scan cannot have seen the edited bytes. A
+    // scan reads at most one byte past the tokens before it (a number
+    // looks at the '.' and digit after it), so the restart token must
+    // begin at least two bytes before the edit.
+    const uint32_t* offsets = tokens.offsetArray();
+    size_t before = offset < 1 ? 0 :
+                    lower_bound(offsets, offsets + tokens.size(), (uint32_t)(offset - 1)) - offsets;
+    size_t restart = before > 0 ? before - 1 : 0;
+    size_t from = before > 0 ? offsets[restart] : 0;
+    
+    // Old tokens that start after the edit are where the rescan can fall
+    // back in step: from such a token on, the text is the same
+    size_t after = lower_bound(offsets, offsets + tokens.size(), (uint32_t)editEnd) - offsets;
+    
+    source.replace(offset, length, replacement);
+    
+    Scanner scanner(source, mode);
+    size_t resume = scanner.scanRange(from, source.size(), &tokens, after, delta);
+    bool rejoined = resume < tokens.size();
+    if (!rejoined) {
+        // Rescanned to the end: only END_OF_FILE is kept (and moved)
+        resume = tokens.size() - 1;
+        unterminated = scanner.unterminated;
+    }
+    uint32_t newEnd = tokens.offset(resume) + delta;
+    uint32_t oldEnd = tokens.offset(resume);
+    
+    // Replace tokens [restart, resume) and move the rest
+    const TokenBuffer& fresh = scanner.buffer;
+    for (size_t i = resume; i < tokens.size(); i++) tokens.offsets[i] += delta;
+    auto splice = [&](auto& into, const auto& from) {
+        into.erase(into.begin() + restart, into.begin() + resume);
+        into.insert(into.begin() + restart, from.begin(), from.end());
+    };
+    splice(tokens.types, fresh.types);
+    splice(tokens.offsets, fresh.offsets);
+    splice(tokens.lengths, fresh.lengths);
+    splice(tokens.symbols, fresh.symbols);
+    tokens.source = source;
+    tokens.count = tokens.types.size();
+    tokens.typeView = tokens.types.data();
+    tokens.offsetView = tokens.offsets.data();
+    tokens.lengthView = tokens.lengths.data();
+    internTokens(restart, restart + fresh.size());
+    stats.tokensScanned = fresh.size();
+    
+    // Line starts and unknown characters follow the same splice
+    tokens.lines.splice(source, from, oldEnd, newEnd, scanner.lines.stringNewlineOffsets());
+    auto firstSite = lower_bound(unknownSites.begin(), unknownSites.end(), (uint32_t)from);
+    auto lastSite = lower_bound(firstSite, unknownSites.end(), oldEnd);
+    for (auto site = lastSite; site != unknownSites.end(); ++site) *site += delta;
+    size_t at = unknownSites.erase(firstSite, lastSite) - unknownSites.begin();
+    unknownSites.insert(unknownSites.begin() + at, scanner.unknownSites.begin(), scanner.unknownSites.end());
+    
+    // Token indices from here on moved by this much
+    int64_t shift = (int64_t)fresh.size() - (int64_t)(resume - restart);
+    size_t changedEnd = restart + fresh.size();     // Past the new tokens
+    
+    // Redo the top-level split from the definition holding the token
+    // before the restart (its first token is unchanged and at depth 0)
+    size_t key = restart > 0 ? restart - 1 : 0;
+    auto holder = upper_bound(definitions.begin(), definitions.end(), key,
+                              [](size_t index, const Definition& d) { return index < d.first; });
+    size_t start = holder - definitions.begin() - 1;
+    
+    // Old definitions past the changed tokens keep their place (moved by
+    // shift). The walk stops at the first one that is still a boundary,
+    // unless its line starts inside the rescanned text: its columns would
+    // be stale, so it is reparsed too.
+    size_t kept = start + 1;
+    while (kept < definitions.size() && definitions[kept].first < resume) kept++;
+    
+    size_t end = tokens.size() - 1;
+    vector<size_t> cuts(1, definitions[start].first);
+    size_t next = Parser::nextTopLevelStart(tokens, definitions[start].first, end);
+    if (next == definitions[start].first) next = Parser::nextTopLevelStart(tokens, next + 1, end);
+    for (; next < end; next = Parser::nextTopLevelStart(tokens, next + 1, end)) {
+        if (next >= changedEnd) {
+            while (kept < definitions.size() && definitions[kept].first + shift < next) kept++;
+            if (kept < definitions.size() && definitions[kept].first + shift == next) {
+                int line = tokens.lines.lineOf(tokens.offset(next));
+                if (tokens.lines.lineStarts()[line - 1] > newEnd) break;
+                kept++;
+            }
+        }
+        cuts.push_back(next);
+    }
+    if (next >= end) kept = definitions.size();
+    
+    for (size_t i = kept; i < definitions.size(); i++) definitions[i].first += shift;
+    definitions.erase(definitions.begin() + start, definitions.begin() + kept);
+    definitions.insert(definitions.begin() + start, cuts.size(), Definition());
+    for (size_t i = 0; i < cuts.size(); i++) definitions[start + i].first = cuts[i];
+    for (size_t i = 0; i < cuts.size(); i++) {
+        parseDefinition(definitions[start + i], definitionEnd(start + i));
+    }
+}
+
+// ==================== Results ====================
+
+Diagnostics EditSession::diagnostics() const {
+    Diagnostics all;
+    const LineIndex& lines = tokens.lineIndex();
+    
+    for (uint32_t site : unknownSites) {
+        SourcePosition position = lines.position(site, 1);
+        all.report(DiagnosticPhase::Scanner, position.line, position.column + 1,
+                   string("Unknown character '") + source[site] + "'");
+    }
+    if (unterminated) {
+        all.report(DiagnosticPhase::Scanner, lines.lineOf(source.size()), 0, "Unterminated string");
+    }
+    
+    // Lines of a kept definition moved with it; its columns did not
+    for (const Definition& definition : definitions) {
+        int moved = lines.lineOf(tokens.offset(definition.first)) - definition.parsedLine;
+        for (const Diagnostic& entry : definition.diagnostics.list()) {
+            all.report(entry.phase, entry.line + moved, entry.column, entry.message, entry.found);
+        }
+    }
+    return all;
+}
+
+bool EditSession::hasError() const {
+    if (!unknownSites.empty() || unterminated) return true;
+    for (const Definition& definition : definitions) {
+        if (definition.hadError) return true;
+    }
+    return false;
+}
+
+void EditSession::buildAst(Ast& ast) const {
+    size_t nodes = 1;
+    for (const Definition& definition : definitions) nodes += definition.ast.size() - 1;
+    ast.reset(source, nodes);
+    
+    NodeId root = ast.add(NodeKind::Program);
+    NodeList statements;
+    for (const Definition& definition : definitions) {
+        int64_t moved = (int64_t)tokens.offset(definition.first) - definition.parsedOffset;
+        for (NodeId stmt = ast.graft(definition.ast, moved); stmt != NO_NODE; stmt = ast.node(stmt).next) {
+            ast.append(statements, stmt);
+        }
+    }
+    ast.node(root).a = statements.first;
+    ast.setRoot(root);
+}
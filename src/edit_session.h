@@ -0,0 +1,92 @@
+#ifndef EDIT_SESSION_H
+#define EDIT_SESSION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "diagnostics.h"
+#include "interner.h"
+#include "line_index.h"
+#include "scanner.h"
+#include "token_buffer.h"
+
+using namespace std;
+
+// Work done by the last EditSession::edit()
+struct EditStats {
+    size_t tokensScanned = 0;       // Tokens produced by the rescan
+    size_t definitionsParsed = 0;   // Top-level definitions reparsed
+};
+
+// EditSession - keeps a source scanned and parsed across text edits
+// The text is split into top-level definitions at each network, init and
+// link statement at brace depth 0 (see Parser::nextTopLevelStart), and
+// each definition is parsed on its own. An edit rescans from just before
+// the changed bytes until the new tokens fall back in step with the old
+// ones, then reparses only the definitions whose tokens changed. Token
+// offsets, line starts and error sites after the edit are moved rather
+// than recomputed; trees and parse errors of untouched definitions are
+// kept as they are and adjusted when read.
+// For a source without syntax errors the tokens, tree and diagnostics are
+// those of a full scan and parse. After a syntax error, parse() may let
+// the error run into the next definition; here each definition recovers
+// on its own. Either way the state after any sequence of edits equals
+// that of a session opened on the final text, except for symbol ids: a
+// name keeps its id for the life of the session, in whatever order edits
+// brought the names in.
+class EditSession {
+private:
+    // One top-level definition; its tokens run up to the next one's first
+    struct Definition {
+        size_t first;               // Index of its first token
+        uint32_t parsedOffset;      // Offset of that token when parsed
+        int parsedLine;             // Its line when parsed
+        Ast ast;                    // Tree with a Program root (offsets as parsed)
+        Diagnostics diagnostics;    // Parse errors (lines as parsed)
+        bool hadError;
+    };
+    
+    string source;                  // Current text
+    ScanMode mode;
+    TokenBuffer tokens;             // Tokens of the current text, END_OF_FILE
+                                    // last; its line index is always built
+    vector<uint32_t> unknownSites;  // Offsets of unknown characters
+    bool unterminated;              // Text ends inside a string
+    Interner interner;              // Names of the symbol ids in tokens and trees
+    vector<Definition> definitions;
+    EditStats stats;
+    
+    void internTokens(size_t first, size_t last);
+    void parseDefinition(Definition& definition, size_t last);
+    size_t definitionEnd(size_t index) const;
+    
+public:
+    explicit EditSession(const string& text, ScanMode mode = ScanMode::Switch);
+    
+    // Tokens and trees point into the session's text
+    EditSession(const EditSession&) = delete;
+    EditSession& operator=(const EditSession&) = delete;
+    
+    // Replace bytes [offset, offset + length) with replacement (clamped to
+    // the text) and bring tokens, trees and errors up to date
+    void edit(size_t offset, size_t length, string_view replacement);
+    
+    string_view text() const { return source; }
+    const TokenBuffer& getTokens() const { return tokens; }
+    const LineIndex& lineIndex() const { return tokens.lineIndex(); }
+    const Interner& getInterner() const { return interner; }
+    const EditStats& lastEdit() const { return stats; }
+    size_t definitionCount() const { return definitions.size(); }
+    
+    // Scanner errors, then parse errors, in source order with current
+    // positions (as main writes them for a full compile)
+    Diagnostics diagnostics() const;
+    bool hasError() const;          // Any scanner or parse error
+    
+    // Join the definitions into one tree over the current text
+    void buildAst(Ast& ast) const;
+};
+
+#endif // EDIT_SESSION_H
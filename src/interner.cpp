@@ -0,0 +1,102 @@
+#include "interner.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Slot 0 of names is the NO_SYMBOL placeholder
+Interner::Interner()
+    : slots(256, Slot{0, NO_SYMBOL}), names(1), block(nullptr), blockUsed(BLOCK_BYTES),
+      arenaBytes(0), reservedBytes(0),
+      lookups(0), probes(0), longestProbe(0) {}
+
+// FNV-1a
+uint32_t Interner::hash(string_view name) {
+    uint32_t h = 2166136261u;
+    for (char c : name) {
+        h ^= (uint8_t)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Copy name into the arena; a long name gets a block of its own
+string_view Interner::store(string_view name) {
+    char* at;
+    if (name.size() > BLOCK_BYTES / 4) {
+        blocks.emplace_back(new char[name.size()]);
+        at = blocks.back().get();
+        reservedBytes += name.size();
+    } else {
+        if (name.size() > BLOCK_BYTES - blockUsed) {
+            blocks.emplace_back(new char[BLOCK_BYTES]);
+            block = blocks.back().get();
+            blockUsed = 0;
+            reservedBytes += BLOCK_BYTES;
+        }
+        at = block + blockUsed;
+        blockUsed += name.size();
+    }
+    
+    memcpy(at, name.data(), name.size());
+    arenaBytes += name.size();
+    return string_view(at, name.size());
+}
+
+// Double the table and reinsert every id (hashes are kept in the slots)
+void Interner::grow() {
+    vector<Slot> old(slots.size() * 2, Slot{0, NO_SYMBOL});
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    
+    for (const Slot& slot : old) {
+        if (slot.id == NO_SYMBOL) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].id != NO_SYMBOL) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+SymbolId Interner::intern(string_view name) {
+    uint32_t h = hash(name);
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    size_t inspected = 1;
+    
+    while (slots[i].id != NO_SYMBOL) {
+        const Slot& slot = slots[i];
+        if (slot.hash == h && names[slot.id] == name) break;
+        i = (i + 1) & mask;
+        inspected++;
+    }
+    
+    lookups++;
+    probes += inspected;
+    longestProbe = max(longestProbe, inspected);
+    if (slots[i].id != NO_SYMBOL) return slots[i].id;
+    
+    SymbolId id = names.size();
+    names.push_back(store(name));
+    slots[i] = Slot{h, id};
+    if (names.size() * 2 > slots.size()) grow();
+    return id;
+}
+
+SymbolId Interner::find(string_view name) const {
+    uint32_t h = hash(name);
+    size_t mask = slots.size() - 1;
+    
+    for (size_t i = h & mask; slots[i].id != NO_SYMBOL; i = (i + 1) & mask) {
+        if (slots[i].hash == h && names[slots[i].id] == name) return slots[i].id;
+    }
+    return NO_SYMBOL;
+}
+
+InternerStats Interner::stats() const {
+    return InternerStats{size(), lookups, probes, longestProbe, slots.size(), arenaBytes};
+}
+
+size_t Interner::memoryBytes() const {
+    return slots.capacity() * sizeof(Slot) + names.capacity() * sizeof(string_view) +
+           reservedBytes;
+}
@@ -0,0 +1,72 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+using namespace std;
+
+// Counters of an Interner, for --stats
+struct InternerStats {
+    size_t symbols;         // Unique names
+    size_t lookups;         // intern() calls
+    size_t probes;          // Slots inspected by those calls
+    size_t longestProbe;    // Most slots inspected by one call
+    size_t capacity;        // Slots in the hash table
+    size_t arenaBytes;      // Bytes of name text stored
+};
+
+// Interner - maps identifier names to dense symbol ids
+// Ids are handed out in order of first appearance, starting at 1, so later
+// passes can compare names as integers and index side tables by symbol.
+// The hash table is open-addressed with linear probing and kept at most
+// half full; each slot holds a name's hash and id, so a probe only
+// compares text when the hashes agree. Names are copied once into an
+// arena of fixed blocks that never move, so name() views stay valid for
+// the life of the interner. Not thread-safe.
+class Interner {
+private:
+    struct Slot {
+        uint32_t hash;
+        SymbolId id;                    // NO_SYMBOL if empty
+    };
+    
+    static const size_t BLOCK_BYTES = 64 * 1024;
+    
+    vector<Slot> slots;                 // Size is a power of two
+    vector<string_view> names;          // names[id], views into blocks
+    vector<unique_ptr<char[]>> blocks;  // Name arena
+    char* block;                        // Block short names go into
+    size_t blockUsed;                   // Bytes used in that block
+    size_t arenaBytes;                  // Bytes of name text
+    size_t reservedBytes;               // Bytes allocated for blocks
+    size_t lookups;
+    size_t probes;
+    size_t longestProbe;
+    
+    static uint32_t hash(string_view name);
+    string_view store(string_view name);
+    void grow();
+    
+public:
+    Interner();
+    
+    // Id of name, adding it if it is new
+    SymbolId intern(string_view name);
+    
+    // Id of name, or NO_SYMBOL if it was never interned
+    SymbolId find(string_view name) const;
+    
+    string_view name(SymbolId id) const { return names[id]; }
+    
+    // Number of names (ids run from 1 to size())
+    size_t size() const { return names.size() - 1; }
+    
+    InternerStats stats() const;
+    size_t memoryBytes() const;
+};
+
+#endif // INTERNER_H
@@ -0,0 +1,119 @@
+#include "line_index.h"
+#include "scan_kernels.h"
+#include <algorithm>
+
+using namespace std;
+
+LineIndex::LineIndex() : built(false) {}
+
+void LineIndex::reset(string_view src) {
+    source = src;
+    stringNewlines.clear();
+    starts.clear();
+    built = false;
+}
+
+// Line 1 starts at offset 0; every byte after a newline starts a line
+void LineIndex::ensureBuilt() const {
+    if (built) return;
+    
+    const ScanKernelTable& kernels = scanKernels();
+    size_t pending = 0;
+    size_t pos = 0;
+    
+    starts.assign(1, 0);
+    while (true) {
+        pos = kernels.findNewline(source.data(), pos, source.length());
+        if (pos == source.length()) break;
+        
+        // Newlines inside strings are rare; they were recorded in order
+        bool inString = pending < stringNewlines.size() && stringNewlines[pending] == pos;
+        if (inString) pending++;
+        starts.push_back(inString ? pos : pos + 1);
+        pos++;
+    }
+    built = true;
+}
+
+void LineIndex::addStringNewline(uint32_t offset) {
+    if (!built) {
+        stringNewlines.push_back(offset);
+        return;
+    }
+    
+    // Already indexed (a position was requested mid-scan): patch in place
+    auto entry = lower_bound(starts.begin(), starts.end(), offset + 1);
+    if (entry != starts.end() && *entry == offset + 1) *entry = offset;
+}
+
+// Binary search for the last line starting at or before offset
+int LineIndex::lineOf(uint32_t offset) const {
+    ensureBuilt();
+    return upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+}
+
+SourcePosition LineIndex::position(uint32_t offset, uint32_t length) const {
+    uint32_t last = length > 0 ? offset + length - 1 : offset;
+    int line = lineOf(last);
+    return { line, (int)offset - (int)starts[line - 1] + 1 };
+}
+
+SourcePosition LineIndex::positionFrom(size_t& line, uint32_t offset, uint32_t length) const {
+    uint32_t last = length > 0 ? offset + length - 1 : offset;
+    ensureBuilt();
+    
+    // Out of order: fall back to a search
+    if (line == 0 || starts[line - 1] > last) line = lineOf(last);
+    
+    while (line < starts.size() && starts[line] <= last) line++;
+    return { (int)line, (int)offset - (int)starts[line - 1] + 1 };
+}
+
+const vector<uint32_t>& LineIndex::lineStarts() const {
+    ensureBuilt();
+    return starts;
+}
+
+void LineIndex::assign(string_view src, const uint32_t* lineStarts, size_t count) {
+    source = src;
+    stringNewlines.clear();
+    starts.assign(lineStarts, lineStarts + count);
+    built = true;
+}
+
+void LineIndex::splice(string_view src, uint32_t from, uint32_t oldEnd, uint32_t newEnd, 
+                       const vector<uint32_t>& newStringNewlines) {
+    const ScanKernelTable& kernels = scanKernels();
+    ensureBuilt();
+    source = src;
+    
+    // Starts of the new lines, found as in ensureBuilt()
+    vector<uint32_t> added;
+    size_t pending = 0;
+    size_t pos = from;
+    while (true) {
+        pos = kernels.findNewline(source.data(), pos, newEnd);
+        if (pos == newEnd) break;
+        bool inString = pending < newStringNewlines.size() && newStringNewlines[pending] == pos;
+        if (inString) pending++;
+        added.push_back(inString ? pos : pos + 1);
+        pos++;
+    }
+    
+    size_t first = upper_bound(starts.begin(), starts.end(), from) - starts.begin();
+    size_t last = upper_bound(starts.begin() + first, starts.end(), oldEnd) - starts.begin();
+    int64_t delta = (int64_t)newEnd - (int64_t)oldEnd;
+    for (size_t i = last; i < starts.size(); i++) starts[i] += delta;
+    
+    starts.erase(starts.begin() + first, starts.begin() + last);
+    starts.insert(starts.begin() + first, added.begin(), added.end());
+}
+
+size_t LineIndex::lineCount() const {
+    ensureBuilt();
+    return starts.size();
+}
+
+size_t LineIndex::memoryBytes() const {
+    return starts.capacity() * sizeof(uint32_t) + stringNewlines.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,77 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+using namespace std;
+
+// Line and column of a source position (both 1-based)
+struct SourcePosition {
+    int line;
+    int column;
+};
+
+// LineIndex - maps byte offsets in the source to (line, column)
+// Holds the offset at which each line starts, built with one vectorized
+// newline search the first time a position is asked for, so scans that
+// never report a position never pay for it. Lookups are binary searches.
+class LineIndex {
+private:
+    string_view source;                 // Text being indexed
+    vector<uint32_t> stringNewlines;    // Newlines inside string literals
+    mutable vector<uint32_t> starts;    // starts[i] = offset of line i+1
+    mutable bool built;                 // True once starts is complete
+    
+    void ensureBuilt() const;
+    
+public:
+    LineIndex();
+    
+    // Index a new source (the text must outlive the index)
+    void reset(string_view source);
+    
+    // Record a newline inside a string literal. Columns after it restart
+    // one byte early (the newline itself counts as column 1), so its line
+    // is indexed as starting at the newline rather than after it.
+    void addStringNewline(uint32_t offset);
+    
+    // Newlines recorded by addStringNewline() before the index was built
+    const vector<uint32_t>& stringNewlineOffsets() const { return stringNewlines; }
+    
+    // 1-based line containing offset
+    int lineOf(uint32_t offset) const;
+    
+    // Line and column of a lexeme: the line is the one holding its last
+    // byte, the column is measured from that line's start
+    SourcePosition position(uint32_t offset, uint32_t length) const;
+    SourcePosition position(const Token& token) const {
+        return position(token.offset, token.lexeme.size());
+    }
+    
+    // Same as position(), for lexemes visited in source order: line holds
+    // the line found last time (0 to start) and the search walks forward
+    // from it, so a full pass over the tokens is linear
+    SourcePosition positionFrom(size_t& line, uint32_t offset, uint32_t length) const;
+    
+    string_view text() const { return source; }
+    // Line start table (builds the index if needed), and the inverse:
+    // adopt a table saved earlier for the same source
+    const vector<uint32_t>& lineStarts() const;
+    void assign(string_view source, const uint32_t* starts, size_t count);
+    
+    // Follow an edit of a built index. Bytes [from, oldEnd) of the old text
+    // became [from, newEnd) of source and the rest moved by the difference.
+    // The lines starting in (from, oldEnd] are replaced by those found in
+    // the new bytes, given the string newlines among them (in order); from
+    // must not be a newline inside a string.
+    void splice(string_view source, uint32_t from, uint32_t oldEnd, uint32_t newEnd, 
+                const vector<uint32_t>& newStringNewlines);
+    
+    size_t lineCount() const;
+    size_t memoryBytes() const;
+};
+
+#endif // LINE_INDEX_H
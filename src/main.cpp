@@ -87,65 +87,425 @@
 //}
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <vector>
+#include "batch.h"
+#include "compiler.h"
+#include "constant_folder.h"
+#include "module_loader.h"
 #include "scanner.h"
 #include "parser.h"
+#include "resolver.h"
+#include "scan_kernels.h"
+#include "source_file.h"
+#include "task_pool.h"
 #include "token.h"
+#include "token_writer.h"
+#include "tree_interpreter.h"
+#include "type_checker.h"
+#include "vm.h"
 
 using namespace std;
 
-// Function to read entire file into a string
-string readFile(const string& filename) {
-    ifstream file(filename);
+// What executes a program after it compiles (--run)
+enum class RunEngine {
+    None,       // Compile only
+    Bytecode,   // Bytecode VM
+    Tree        // Reference tree-walking interpreter
+};
 
-    if (!file.is_open()) {
+// Open the source file (memory-mapped where possible), exiting on failure
+void openSource(SourceFile& source, const string& filename) {
+    if (!source.open(filename)) {
         cerr << "Error: Could not open file '" << filename << "'" << endl;
         exit(1);
     }
-
-    stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-
-    return buffer.str();
 }
 
 // Display usage information
 void printUsage(const string& programName) {
     cout << "NetC Compiler - Scanner and Parser\n";
     cout << "Usage: " << programName << " <input_file.netc> [options]\n";
+    cout << "       " << programName << " <files | directories | @manifest>... [options]\n";
+    cout << "       (use '-' as the input file to read from standard input)\n";
     cout << "Options:\n";
     cout << "  -s, --scan-only    Run scanner only (skip parsing)\n";
     cout << "  -p, --parse-only   Run parser only (skip token display)\n";
+    cout << "  --kernel=NAME      Scanner kernel: auto, scalar, sse2, avx2\n";
+    cout << "  --lexer=NAME       Token recognizer: switch (default), table\n";
+    cout << "  --cache            Reuse/save scanned tokens in a .ntok file next to the source\n";
+    cout << "  -j N               Scan and parse the file on N threads (0 = one per hardware thread)\n";
+    cout << "  --stats            Report storage footprint and semantic pass times\n";
+    cout << "  --dump-ast         Print the syntax tree after parsing\n";
+    cout << "  -v, --verbose      Trace grammar rules while parsing (debug builds)\n";
+    cout << "  --load-links       Load the files named by link statements (each once)\n";
+    cout << "  -I DIR             Also search DIR for linked files (after the linking file's own)\n";
+    cout << "  --max-depth=N      Deepest block/expression nesting accepted (default "
+         << Parser::DEFAULT_MAX_DEPTH << ")\n";
+    cout << "  --run[=ENGINE]     Run the program: vm (bytecode, default) or tree (tree walker);\n";
+    cout << "                     feed reads lines from standard input, forward writes lines\n";
+    cout << "  --dump-bytecode    Print the compiled bytecode\n";
+    cout << "  -O, --optimize     Fold constants and drop dead branches before code generation\n";
+    cout << "Batch mode (several inputs, a directory or an @manifest of paths):\n";
+    cout << "  --batch            Use batch mode even for a single file\n";
+    cout << "  -j N               Worker threads (default: one per hardware thread)\n";
     cout << "Example: " << programName << " test.netc\n";
 }
 
+// Save the token table to outputFilename; false if it cannot be created
+bool writeTokenDump(const TokenBuffer& tokens, const string& filename, 
+                    const string& outputFilename) {
+    FILE* outFile = fopen(outputFilename.c_str(), "wb");
+    if (!outFile) return false;
+
+    TokenWriter writer(outFile, TokenTableStyle::File);
+    writer.write("Token Analysis for: ");
+    writer.write(filename);
+    writer.write("\n\n");
+    writer.write("Line\tCol\tType\t\t\tLexeme\n");
+    writer.write("----\t---\t----\t\t\t------\n");
+
+    size_t line = 0;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        TokenType type = tokens.type(i);
+        if (type != COMMENT) {
+            SourcePosition position = tokens.lineIndex().positionFrom(line, tokens.offset(i), tokens.length(i));
+            writer.writeToken(position, type, tokens.lexeme(i));
+        }
+    }
+
+    writer.flush();
+    fclose(outFile);
+    return true;
+}
+
+// Print the syntax tree and/or its footprint after a parse
+void reportAst(const Ast& ast, bool dumpAst, bool showStats) {
+    if (dumpAst) {
+        cout << "\nSyntax tree:\n";
+        ast.dump(cout);
+    }
+    if (showStats) {
+        cout << "AST storage: " << ast.size() << " nodes, " << ast.memoryBytes() 
+             << " bytes (" << sizeof(Node) << " bytes per node)\n";
+    }
+}
+
+// Print the identifier interner's table statistics
+void reportInterner(const Interner& interner) {
+    InternerStats stats = interner.stats();
+    char average[32];
+    snprintf(average, sizeof(average), "%.2f", stats.lookups ? (double)stats.probes / stats.lookups : 0.0);
+
+    cout << "Identifier interner: " << stats.symbols << " unique names in " << stats.lookups
+         << " lookups, " << stats.arenaBytes << " bytes of names\n";
+    cout << "  Probe length: " << average << " average, "
+         << stats.longestProbe << " longest (" << stats.capacity << " slots, "
+         << interner.memoryBytes() << " bytes)\n";
+}
+
+// Print how long a pass over the tree took, and its rate in nodes
+void reportPassTime(const char* pass, double seconds, size_t nodes) {
+    char rate[64];
+    snprintf(rate, sizeof(rate), "%.3f ms (%.1f M nodes/s)", seconds * 1e3,
+             seconds > 0 ? nodes / seconds / 1e6 : 0.0);
+    cout << pass << " time: " << rate << "\n";
+}
+
+// Compile a checked program to bytecode and run it on engine; returns the
+// exit status
+int runProgram(const Ast& ast, const Resolver& resolver, const TypeChecker& checker,
+               const LineIndex& lines, RunEngine engine, bool dumpBytecode, bool showStats) {
+    BytecodeProgram program;
+    BytecodeCompiler compiler(ast, resolver, checker, lines);
+    bool compiled = compiler.compile(program);
+    cout << "Bytecode: " << program.code.size() << " instructions in " << program.functions.size()
+         << " functions (" << program.memoryBytes() << " bytes)\n";
+    if (dumpBytecode) {
+        cout << "\nBytecode:\n";
+        program.dump(cout);
+    }
+    cout.flush();
+    compiler.getDiagnostics().flush(stderr);
+    if (!compiled) {
+        cout << "\n============================================\n";
+        cout << "Code generation failed with errors!\n";
+        cout << "============================================\n";
+        return 1;
+    }
+    if (engine == RunEngine::None) return 0;
+
+    cout << "Running on the " << (engine == RunEngine::Tree ? "tree-walking interpreter" : "bytecode VM")
+         << "\n\n";
+    cout.flush();
+
+    bool ok;
+    bool hasResult;
+    string result;
+    size_t calls;
+    Diagnostics runtimeErrors;
+    auto start = chrono::steady_clock::now();
+    if (engine == RunEngine::Tree) {
+        TreeInterpreter interpreter(ast, resolver, checker, lines, stdin, stdout);
+        ok = interpreter.run();
+        hasResult = interpreter.hasResult();
+        result = interpreter.result();
+        calls = interpreter.callCount();
+        runtimeErrors = interpreter.getDiagnostics();
+    } else {
+        VM vm(program, lines, stdin, stdout);
+        ok = vm.run();
+        hasResult = vm.hasResult();
+        result = vm.result();
+        calls = vm.callCount();
+        runtimeErrors = vm.getDiagnostics();
+    }
+    chrono::duration<double> runTime = chrono::steady_clock::now() - start;
+
+    cout << "\n";
+    if (hasResult) cout << "Program yielded: " << result << "\n";
+    if (showStats) {
+        char time[32];
+        snprintf(time, sizeof(time), "%.3f ms", runTime.count() * 1e3);
+        cout << "Network calls: " << calls << "\n";
+        cout << "Execution time: " << time << "\n";
+    }
+    cout.flush();
+    runtimeErrors.flush(stderr);
+
+    if (!ok) {
+        cout << "\n============================================\n";
+        cout << "Execution failed with errors!\n";
+        cout << "============================================\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Write scanner errors, then parser and link errors, to stderr in one block
+void emitDiagnostics(const Scanner& scanner, const Diagnostics* parserErrors, 
+                     const Diagnostics* linkErrors = nullptr) {
+    Diagnostics all = scanner.getDiagnostics();
+    if (parserErrors) all.append(*parserErrors);
+    if (linkErrors) all.append(*linkErrors);
+
+    // Keep the report after everything already printed to stdout
+    cout.flush();
+    all.flush(stderr);
+}
+
+// Write the errors of every loaded module (each prefixed with its path) to
+// stderr in one write, except the inputs in reported (canonical paths),
+// whose errors were already written; returns the number of modules with
+// errors
+size_t reportModules(ModuleLoader& loader, const set<string>& reported = {}) {
+    string report;
+    size_t failed = 0;
+
+    for (const Module* module : loader.loaded()) {
+        if (module->diagnostics.empty() || reported.count(module->path)) continue;
+        report += module->diagnostics.render(module->path + ": ");
+        failed++;
+    }
+
+    cout.flush();
+    fwrite(report.data(), 1, report.size(), stderr);
+    fflush(stderr);
+    return failed;
+}
+
+// Compile many files on a thread pool and report per-file errors
+int runBatchMode(const vector<string>& inputs, BatchOptions& options, 
+                 const vector<string>& searchPaths, bool loadLinks) {
+    vector<string> files;
+    string error;
+    if (!collectBatchInputs(inputs, files, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+
+    TaskPool pool(options.jobs);
+    cout << "============================================\n";
+    cout << "NetC Compiler - Batch Mode\n";
+    cout << "============================================\n";
+    cout << "Input files: " << files.size() << "\n";
+    cout << "Worker threads: " << pool.workerCount() << "\n";
+    cout << "============================================\n";
+
+    ModuleLoader loader;
+    if (loadLinks) {
+        for (const string& dir : searchPaths) loader.addSearchPath(dir);
+        loader.setScanMode(options.scanMode);
+        loader.setMaxDepth(options.maxDepth);
+        options.loader = &loader;
+    }
+
+    vector<BatchResult> results = runBatch(files, options);
+
+    size_t tokens = 0;
+    size_t cached = 0;
+    for (const BatchResult& result : results) {
+        tokens += result.tokens;
+        cached += result.cached;
+    }
+
+    // Errors go out after the header, in input order
+    cout.flush();
+    size_t failed = reportBatch(results, stderr);
+    set<string> inputPaths;
+    for (const string& file : files) inputPaths.insert(ModuleLoader::canonicalPath(file));
+    size_t modulesFailed = loadLinks ? reportModules(loader, inputPaths) : 0;
+
+    cout << "\nFiles compiled: " << results.size() << "\n";
+    if (options.useCache) cout << "Loaded from cache: " << cached << "\n";
+    cout << "Total tokens: " << tokens << "\n";
+    cout << "Files with errors: " << failed << "\n";
+    if (loadLinks) {
+        cout << "Linked modules loaded: " << loader.loaded().size() - inputPaths.size() << "\n";
+        cout << "Modules with errors: " << modulesFailed << "\n";
+    }
+    cout << "============================================\n";
+    return failed > 0 || modulesFailed > 0 ? 1 : 0;
+}
+
 int main(int argc, char* argv[]) {
     // Initialize token type names for printing
     initializeTokenTypeNames();
 
     // Parse command line arguments
-    if (argc < 2) {
-        printUsage(argv[0]);
-        return 1;
-    }
-
-    string filename = argv[1];
+    vector<string> inputs;
+    bool batch = false;
+    unsigned jobs = 0;
+    bool jobsGiven = false;
     bool scanOnly = false;
     bool parseOnly = false;
+    bool showStats = false;
+    bool dumpAst = false;
+    bool dumpBytecode = false;
+    bool optimize = false;
+    RunEngine engine = RunEngine::None;
+    size_t maxDepth = Parser::DEFAULT_MAX_DEPTH;
+    int verbosity = 0;
+    bool useCache = false;
+    bool loadLinks = false;
+    vector<string> searchPaths;
+    ScanMode scanMode = ScanMode::Switch;
 
-    // Check for options
-    for (int i = 2; i < argc; i++) {
+    // Options may come before or after the inputs
+    for (int i = 1; i < argc; i++) {
         string arg = argv[i];
-        if (arg == "-s" || arg == "--scan-only") {
+        if (arg == "-" || arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else if (arg == "--batch") {
+            batch = true;
+        }
+        else if (arg.rfind("-j", 0) == 0) {
+            string value = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            char* end;
+            unsigned long count = strtoul(value.c_str(), &end, 10);
+            if (*end != '\0' || value.empty()) {
+                cerr << "Error: Invalid job count '" << value << "'" << endl;
+                return 1;
+            }
+            jobs = (unsigned)count;
+            jobsGiven = true;
+        }
+        else if (arg == "-s" || arg == "--scan-only") {
             scanOnly = true;
         }
         else if (arg == "-p" || arg == "--parse-only") {
             parseOnly = true;
         }
+        else if (arg == "-v" || arg == "--verbose") {
+            verbosity++;
+        }
+        else if (arg.rfind("-I", 0) == 0) {
+            string dir = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            if (dir.empty()) {
+                cerr << "Error: Missing directory after -I" << endl;
+                return 1;
+            }
+            searchPaths.push_back(dir);
+        }
+        else if (arg == "--load-links") {
+            loadLinks = true;
+        }
+        else if (arg == "--cache") {
+            useCache = true;
+        }
+        else if (arg == "--stats") {
+            showStats = true;
+        }
+        else if (arg == "--dump-ast") {
+            dumpAst = true;
+        }
+        else if (arg == "--dump-bytecode") {
+            dumpBytecode = true;
+        }
+        else if (arg == "-O" || arg == "--optimize") {
+            optimize = true;
+        }
+        else if (arg == "--run" || arg == "--run=vm") {
+            engine = RunEngine::Bytecode;
+        }
+        else if (arg == "--run=tree") {
+            engine = RunEngine::Tree;
+        }
+        else if (arg.rfind("--run=", 0) == 0) {
+            cerr << "Error: Unknown engine '" << arg.substr(6) << "'" << endl;
+            return 1;
+        }
+        else if (arg == "--lexer=table") {
+            scanMode = ScanMode::Table;
+        }
+        else if (arg == "--lexer=switch") {
+            scanMode = ScanMode::Switch;
+        }
+        else if (arg.rfind("--max-depth=", 0) == 0) {
+            char* end;
+            unsigned long limit = strtoul(arg.c_str() + 12, &end, 10);
+            if (*end != '\0' || end == arg.c_str() + 12 || limit == 0) {
+                cerr << "Error: Invalid nesting limit '" << arg.substr(12) << "'" << endl;
+                return 1;
+            }
+            maxDepth = limit;
+        }
+        else if (arg.rfind("--kernel=", 0) == 0) {
+            ScanKernel kernel;
+            if (!parseScanKernel(arg.c_str() + 9, kernel)) {
+                cerr << "Error: Unknown scanner kernel '" << arg.substr(9) << "'" << endl;
+                return 1;
+            }
+            if (!setScanKernel(kernel)) {
+                cerr << "Error: Scanner kernel '" << arg.substr(9) 
+                     << "' is not supported on this machine" << endl;
+                return 1;
+            }
+        }
     }
 
+    if (inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (batch || isBatchInput(inputs)) {
+        BatchOptions options;
+        options.jobs = jobs;
+        options.scanOnly = scanOnly;
+        options.useCache = useCache;
+        options.scanMode = scanMode;
+        options.maxDepth = maxDepth;
+        return runBatchMode(inputs, options, searchPaths, loadLinks);
+    }
+
+    string filename = inputs[0];
+
     cout << "============================================\n";
     cout << "NetC Compiler - Lexical and Syntax Analysis\n";
     cout << "============================================\n";
@@ -156,46 +516,72 @@ int main(int argc, char* argv[]) {
     cout << "PHASE 1: LEXICAL ANALYSIS (SCANNER)\n";
     cout << "--------------------------------------------\n";
 
-    // Read source file
-    string sourceCode = readFile(filename);
+    // Map source file (must outlive the scanner and its tokens)
+    SourceFile sourceFile;
+    openSource(sourceFile, filename);
+
+    // Create scanner
+    Scanner scanner(sourceFile);
+    scanner.setMode(scanMode);
+
+    // Reuse the tokens of an unchanged source from its .ntok cache
+    TokenCache cache;
+    bool cacheable = useCache && filename != "-";
+    string cachePath = cacheable ? TokenCache::pathFor(filename) : "";
+    bool cached = cacheable && scanner.loadCache(cache, cachePath);
 
-    // Create scanner and tokenize
-    Scanner scanner(sourceCode);
-    vector<Token> tokens = scanner.scanTokens();
+    // Parse-only mode streams tokens straight into the parser, so the
+    // whole token list is never held in memory (unless it is cached or
+    // scanned in parallel)
+    bool streaming = parseOnly && !scanOnly && !useCache && !jobsGiven;
+    const TokenBuffer& tokens = scanner.getBuffer();
 
-    cout << "Scanning completed!\n";
-    cout << "Total tokens found: " << tokens.size() << "\n";
+    if (streaming) {
+        cout << "Streaming tokens into the parser\n";
+    } else if (cached) {
+        cout << "Tokens loaded from cache: " << cachePath << "\n";
+        cout << "Total tokens found: " << tokens.size() << "\n";
+    } else {
+        if (jobsGiven) scanner.scanBufferParallel(jobs);
+        else scanner.scanBuffer();
+
+        cout << "Scanning completed!\n";
+        cout << "Total tokens found: " << tokens.size() << "\n";
+
+        // Sources with lexical errors are not cached, so the errors are
+        // reported again on every run
+        if (cacheable && scanner.getDiagnostics().empty() &&
+            TokenCache::save(cachePath, sourceFile.text(), tokens)) {
+            cout << "Token cache saved to: " << cachePath << "\n";
+        }
+
+        if (showStats) {
+            size_t lineCount = tokens.lineIndex().lineCount();
+            cout << "Token storage:\n";
+            cout << "  Token list (array of structs): " << tokens.size() * sizeof(Token) 
+                 << " bytes\n";
+            cout << "  Token buffer (struct of arrays): " << tokens.memoryBytes() 
+                 << " bytes (including " << lineCount << " line starts)\n";
+            reportInterner(scanner.getInterner());
+        }
+    }
 
     // Display tokens if not parse-only mode
     if (!parseOnly) {
         scanner.printTokens();
 
         // Save tokens to file
-        string outputFilename = filename.substr(0, filename.find_last_of('.')) + "_tokens.txt";
-        ofstream outFile(outputFilename);
-
-        if (outFile.is_open()) {
-            outFile << "Token Analysis for: " << filename << "\n\n";
-            outFile << "Line\tCol\tType\t\t\tLexeme\n";
-            outFile << "----\t---\t----\t\t\t------\n";
-
-            for (const auto& token : tokens) {
-                if (token.type != COMMENT) {
-                    outFile << token.line << "\t" << token.column << "\t"
-                        << tokenTypeToString(token.type) << "\t\t";
-                    if (tokenTypeToString(token.type).length() < 16) outFile << "\t";
-                    if (tokenTypeToString(token.type).length() < 8) outFile << "\t";
-                    outFile << token.lexeme << "\n";
-                }
-            }
+        string baseName = filename == "-" ? "stdin" : filename;
+        string outputFilename = baseName.substr(0, baseName.find_last_of('.')) + "_tokens.txt";
 
-            outFile.close();
+        if (writeTokenDump(tokens, filename, outputFilename)) {
             cout << "\nToken list saved to: " << outputFilename << "\n";
         }
     }
 
     // If scan-only mode, exit here
     if (scanOnly) {
+        emitDiagnostics(scanner, nullptr);
         cout << "\n============================================\n";
         cout << "Scan-only mode: Parsing skipped\n";
         cout << "============================================\n";
@@ -208,19 +594,132 @@ int main(int argc, char* argv[]) {
     cout << "--------------------------------------------\n";
 
     // Create parser and parse
-    Parser parser(tokens);
-    parser.parse();
+    bool failed;
+    ModuleLoader loader;
+    vector<string> linkTargets;
+    Diagnostics linkErrors;
+    for (const string& dir : searchPaths) loader.addSearchPath(dir);
+    loader.setScanMode(scanMode);
+    loader.setMaxDepth(maxDepth);
+    unique_ptr<Parser> parser(streaming ? new Parser(scanner) : new Parser(tokens));
+    parser->setMaxDepth(maxDepth);
+    parser->setVerbosity(verbosity);
+    if (jobsGiven) parser->parseParallel(jobs);
+    else parser->parse();
+    const Ast& ast = parser->getAst();
+
+    if (streaming) {
+        // Scan whatever the parser left unread so every lexical error is
+        // reported and the count covers the whole source, as in the other modes
+        while (scanner.nextToken().type != END_OF_FILE) {}
+        cout << "Total tokens found: " << scanner.tokenCount() << "\n";
+        reportAst(ast, dumpAst, showStats);
+        if (showStats) reportInterner(scanner.getInterner());
+    } else {
+        reportAst(ast, dumpAst, showStats);
+    }
+    if (loadLinks) {
+        loader.resolveLinks(ast, scanner.lineIndex(), filename, linkTargets, linkErrors);
+    }
+    emitDiagnostics(scanner, &parser->getDiagnostics(), &linkErrors);
+    failed = parser->hasError();
+
+    // ==================== LINKED MODULES ====================
+    bool linkFailed = !linkErrors.empty();
+    vector<const Module*> modules;
+    if (loadLinks) {
+        modules = loader.loadAll(filename, linkTargets, jobsGiven ? jobs : 0);
+        cout << "Linked modules loaded: " << modules.size() << "\n";
+        linkFailed = reportModules(loader) > 0 || linkFailed;
+    }
 
     // Check for errors
-    if (parser.hasError()) {
+    if (failed) {
         cout << "\n============================================\n";
         cout << "Parsing failed with errors!\n";
         cout << "============================================\n";
         return 1;
     }
 
+    // ==================== SEMANTIC PHASE ====================
+    cout << "\n\n";
+    cout << "PHASE 3: SEMANTIC ANALYSIS\n";
+    cout << "--------------------------------------------\n";
+
+    // Calls into linked modules are only checked once they all loaded cleanly
+    Resolver resolver(ast, scanner.getInterner(), scanner.lineIndex());
+    for (const Module* module : modules) {
+        if (module->parser) resolver.addLinkedNetworks(module->parser->getAst());
+    }
+    resolver.setLinksLoaded(loadLinks && !linkFailed);
+
+    auto resolveStart = chrono::steady_clock::now();
+    resolver.resolve();
+    chrono::duration<double> resolveTime = chrono::steady_clock::now() - resolveStart;
+    cout << "Names resolved: " << resolver.referenceCount() << "\n";
+    if (showStats) reportPassTime("Resolution", resolveTime.count(), ast.size());
+
+    // Types are only checked once every name resolved
+    TypeChecker checker(ast, resolver, scanner.lineIndex());
+    checker.setMaxDepth(maxDepth);
+    if (!resolver.hasError()) {
+        auto checkStart = chrono::steady_clock::now();
+        checker.check();
+        chrono::duration<double> checkTime = chrono::steady_clock::now() - checkStart;
+        cout << "Expressions typed: " << checker.expressionCount() << "\n";
+        if (showStats) reportPassTime("Type checking", checkTime.count(), ast.size());
+    }
+
+    Diagnostics semanticErrors = resolver.getDiagnostics();
+    semanticErrors.append(checker.getDiagnostics());
+    cout.flush();
+    semanticErrors.flush(stderr);
+
+    if (!semanticErrors.empty()) {
+        cout << "\n============================================\n";
+        cout << "Semantic analysis failed with errors!\n";
+        cout << "============================================\n";
+        return 1;
+    }
+
+    if (linkFailed) {
+        cout << "\n============================================\n";
+        cout << "Linked modules have errors!\n";
+        cout << "============================================\n";
+        return 1;
+    }
+
+    // Folding rewrites the checked tree in place; node ids (and so the
+    // resolver's and checker's tables) stay valid
+    if (optimize) {
+        ConstantFolder folder(parser->getAst());
+        auto foldStart = chrono::steady_clock::now();
+        folder.fold();
+        chrono::duration<double> foldTime = chrono::steady_clock::now() - foldStart;
+        cout << "Constant folding: " << folder.foldedCount() << " expressions folded, "
+             << folder.branchCount() << " dead branches removed, " << folder.removedCount()
+             << " nodes removed\n";
+        if (showStats) reportPassTime("Constant folding", foldTime.count(), ast.size());
+        if (dumpAst) {
+            cout << "\nFolded syntax tree:\n";
+            ast.dump(cout);
+        }
+    }
+
+    // ==================== EXECUTION PHASE ====================
+    if (engine != RunEngine::None || dumpBytecode) {
+        cout << "\n\n";
+        cout << (engine != RunEngine::None ? "PHASE 4: CODE GENERATION AND EXECUTION\n" 
+                                           : "PHASE 4: CODE GENERATION\n");
+        cout << "--------------------------------------------\n";
+        if (runProgram(ast, resolver, checker, scanner.lineIndex(), engine, dumpBytecode, showStats) != 0) {
+            return 1;
+        }
+    }
+
     cout << "\n============================================\n";
-    cout << "Compilation completed successfully!\n";
+    cout << (engine != RunEngine::None ? "Execution completed successfully!\n" 
+                                       : "Compilation completed successfully!\n");
     cout << "============================================\n";
 
     return 0;
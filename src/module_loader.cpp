@@ -0,0 +1,164 @@
+#include "module_loader.h"
+#include <filesystem>
+#include <set>
+#include "resolver.h"
+#include "task_pool.h"
+#include "type_checker.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+ModuleLoader::ModuleLoader() : scanMode(ScanMode::Switch), maxDepth(Parser::DEFAULT_MAX_DEPTH) {}
+
+// ==================== Resolution ====================
+
+string ModuleLoader::canonicalPath(const string& path) {
+    error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    return ec ? path : canonical.string();
+}
+
+string ModuleLoader::resolve(const string& link, const string& importer) const {
+    fs::path relative(link);
+    vector<fs::path> candidates;
+    
+    if (relative.is_absolute()) {
+        candidates.push_back(relative);
+    } else {
+        candidates.push_back(fs::path(importer).parent_path() / relative);
+        for (const string& dir : searchPaths) candidates.push_back(fs::path(dir) / relative);
+    }
+    
+    for (const fs::path& candidate : candidates) {
+        error_code ec;
+        if (fs::is_regular_file(candidate, ec)) return canonicalPath(candidate.string());
+    }
+    return "";
+}
+
+void ModuleLoader::resolveLinks(const Ast& ast, const LineIndex& lines, const string& importer,
+                                vector<string>& targets, Diagnostics& diagnostics) const {
+    // Nodes are created in source order, so a pass over the arena visits
+    // the links in order wherever they are nested
+    for (NodeId id = 1; id <= ast.size(); id++) {
+        const Node& node = ast.node(id);
+        if (node.kind != NodeKind::Link) continue;
+        
+        // The node text is the path literal, quotes included
+        string_view literal = ast.text(id);
+        string link(literal.substr(1, literal.size() - 2));
+        string target = resolve(link, importer);
+        
+        if (target.empty()) {
+            SourcePosition position = lines.position(node.offset, node.length);
+            diagnostics.report(DiagnosticPhase::Linker, position.line, position.column,
+                               "Cannot find linked module '" + link + "'");
+        } else {
+            targets.push_back(target);
+        }
+    }
+}
+
+// ==================== Loading ====================
+
+// Scan, parse and resolve the links of one module
+shared_ptr<Module> ModuleLoader::load(const string& path) const {
+    shared_ptr<Module> module = make_shared<Module>();
+    module->path = path;
+    
+    if (!module->source.open(path)) {
+        module->diagnostics.report(DiagnosticPhase::Driver, 0, 0,
+                                   "Could not open file '" + path + "'");
+        return module;
+    }
+    
+    module->scanner.reset(new Scanner(module->source));
+    Scanner& scanner = *module->scanner;
+    scanner.setMode(scanMode);
+    scanner.scanBuffer();
+    
+    module->parser.reset(new Parser(scanner.getBuffer()));
+    Parser& parser = *module->parser;
+    parser.setVerbosity(-1);
+    parser.setMaxDepth(maxDepth);
+    parser.parse();
+    
+    module->diagnostics = scanner.getDiagnostics();
+    module->diagnostics.append(parser.getDiagnostics());
+    resolveLinks(parser.getAst(), scanner.lineIndex(), path, module->links, module->diagnostics);
+    
+    // Its links load after it, so calls into them are not checked
+    if (!parser.hasError()) {
+        Resolver resolver(parser.getAst(), scanner.getInterner(), scanner.lineIndex());
+        resolver.resolve();
+        module->diagnostics.append(resolver.getDiagnostics());
+        if (!resolver.hasError()) {
+            TypeChecker checker(parser.getAst(), resolver, scanner.lineIndex());
+            checker.setMaxDepth(maxDepth);
+            checker.check();
+            module->diagnostics.append(checker.getDiagnostics());
+        }
+    }
+    return module;
+}
+
+const Module& ModuleLoader::get(const string& path) {
+    promise<shared_ptr<Module>> loading;
+    shared_future<shared_ptr<Module>> result;
+    bool owner = false;
+    
+    {
+        lock_guard<mutex> guard(lock);
+        auto entry = modules.find(path);
+        if (entry == modules.end()) {
+            result = loading.get_future().share();
+            modules.emplace(path, result);
+            owner = true;
+        } else {
+            result = entry->second;
+        }
+    }
+    
+    // Loading a module never waits on another one (its links are loaded
+    // by the caller afterwards), so link cycles cannot deadlock
+    if (owner) loading.set_value(load(path));
+    return *result.get();
+}
+
+vector<const Module*> ModuleLoader::loadAll(const string& importer, const vector<string>& targets,
+                                            unsigned jobs) {
+    vector<const Module*> reached;
+    set<string> seen;
+    seen.insert(canonicalPath(importer));
+    
+    vector<string> frontier;
+    for (const string& target : targets) {
+        if (seen.insert(target).second) frontier.push_back(target);
+    }
+    
+    // One level of the link graph at a time: the modules of a level load
+    // in parallel, then their links form the next level
+    TaskPool pool(jobs);
+    while (!frontier.empty()) {
+        vector<const Module*> level(frontier.size());
+        pool.run(frontier.size(), [&](size_t i) {
+            level[i] = &get(frontier[i]);
+        });
+        
+        frontier.clear();
+        for (const Module* module : level) {
+            reached.push_back(module);
+            for (const string& link : module->links) {
+                if (seen.insert(link).second) frontier.push_back(link);
+            }
+        }
+    }
+    return reached;
+}
+
+vector<const Module*> ModuleLoader::loaded() {
+    lock_guard<mutex> guard(lock);
+    vector<const Module*> list;
+    for (auto& entry : modules) list.push_back(entry.second.get().get());
+    return list;
+}
@@ -0,0 +1,84 @@
+#ifndef MODULE_LOADER_H
+#define MODULE_LOADER_H
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "diagnostics.h"
+#include "line_index.h"
+#include "parser.h"
+#include "scanner.h"
+#include "source_file.h"
+
+using namespace std;
+
+// A linked source file, scanned and parsed once per process
+// The scanner and parser point into source, so they are created after it
+// and live with it.
+struct Module {
+    string path;                    // Canonical path (the loader's key)
+    SourceFile source;
+    unique_ptr<Scanner> scanner;    // Null if the file could not be opened
+    unique_ptr<Parser> parser;
+    vector<string> links;           // Canonical paths of resolved links
+    Diagnostics diagnostics;        // Open, scan, parse, link and semantic errors
+};
+
+// ModuleLoader - resolves `link "path";` statements and loads the files
+// A link is looked up next to the file that contains it, then in each
+// search path in order. Modules are cached by canonical path for the life
+// of the loader, and concurrent requests for the same path wait for a
+// single load, so a module reached through many importers (or from many
+// batch workers) is scanned and parsed exactly once.
+class ModuleLoader {
+private:
+    vector<string> searchPaths;
+    ScanMode scanMode;
+    size_t maxDepth;
+    
+    mutex lock;                                             // Guards modules
+    map<string, shared_future<shared_ptr<Module>>> modules; // By canonical path
+    
+    shared_ptr<Module> load(const string& path) const;
+
+public:
+    ModuleLoader();
+    
+    void addSearchPath(const string& dir) { searchPaths.push_back(dir); }
+    void setScanMode(ScanMode mode) { scanMode = mode; }
+    void setMaxDepth(size_t limit) { maxDepth = limit; }
+    
+    // Path used as the cache key for a file (the path itself if it
+    // cannot be made canonical)
+    static string canonicalPath(const string& path);
+    
+    // Canonical path of a link written in importer, or "" if no candidate
+    // file exists
+    string resolve(const string& link, const string& importer) const;
+    
+    // Resolve every link statement of a parsed file. Targets are added to
+    // targets in source order; links that cannot be found are reported to
+    // diagnostics at the position of their path.
+    void resolveLinks(const Ast& ast, const LineIndex& lines, const string& importer,
+                      vector<string>& targets, Diagnostics& diagnostics) const;
+    
+    // Module at a canonical path, loading it on the first request. Thread-safe.
+    const Module& get(const string& path);
+    
+    // Load the targets and everything they link to, breadth first, on up
+    // to `jobs` threads (0 = one per hardware thread). The importing file
+    // itself (importer) is never loaded as a module. Returns the modules
+    // reached, in the order they were first reached.
+    vector<const Module*> loadAll(const string& importer, const vector<string>& targets,
+                                  unsigned jobs);
+    
+    // Every module loaded so far, ordered by path. Call only while no
+    // loads are running.
+    vector<const Module*> loaded();
+};
+
+#endif // MODULE_LOADER_H
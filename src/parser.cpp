@@ -1,38 +1,71 @@
 #include "parser.h"
+#include "task_pool.h"
 #include <iostream>
+#include <charconv>
+#include <memory>
+#include <string>
 
 using namespace std;
 
-// Constructor
-Parser::Parser(vector<Token> tokens) : tokens(tokens), current(0), hadError(false) {}
+// Grammar rule trace, compiled out of release (NDEBUG) builds
+#ifdef NDEBUG
+#define TRACE(message) ((void)0)
+#else
+#define TRACE(message) do { if (verbosity > 0) cout << message << '\n'; } while (0)
+#endif
+
+// Constructor - parse a scanned token list
+Parser::Parser(const vector<Token>& tokens, const LineIndex& lines) 
+    : stream(tokens, lines), hadError(false),
+      depth(0), maxDepth(DEFAULT_MAX_DEPTH), abandoned(false), verbosity(0) {}
+
+// Constructor - parse struct-of-arrays tokens
+Parser::Parser(const TokenBuffer& tokens) 
+    : stream(tokens), hadError(false),
+      depth(0), maxDepth(DEFAULT_MAX_DEPTH), abandoned(false), verbosity(0) {}
+
+// Constructor - parse one run of a token buffer (parseParallel)
+Parser::Parser(const TokenBuffer& tokens, size_t first, size_t last) 
+    : stream(tokens, first, last), hadError(false),
+      depth(0), maxDepth(DEFAULT_MAX_DEPTH), abandoned(false), verbosity(-1) {}
+
+// Constructor - pull tokens from the scanner as parsing proceeds
+Parser::Parser(Scanner& scanner) 
+    : stream(scanner), hadError(false),
+      depth(0), maxDepth(DEFAULT_MAX_DEPTH), abandoned(false), verbosity(0) {}
 
 // ==================== Utility Methods ====================
 
+// Return the type of the current token without building the full token
+TokenType Parser::peekType() {
+    return stream.peekType();
+}
+
 // Return current token without consuming it
-Token Parser::peek() {
-    return tokens[current];
+const Token& Parser::peek() {
+    return stream.peek();
 }
 
 // Return previous token
-Token Parser::previous() {
-    return tokens[current - 1];
+const Token& Parser::previous() {
+    return stream.previous();
 }
 
 // Consume and return current token
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+const Token& Parser::advance() {
+    stream.advance();
     return previous();
 }
 
 // Check if we've reached end of tokens
 bool Parser::isAtEnd() {
-    return peek().type == END_OF_FILE;
+    return peekType() == END_OF_FILE;
 }
 
 // Check if current token matches type
 bool Parser::check(TokenType type) {
     if (isAtEnd()) return false;
-    return peek().type == type;
+    return peekType() == type;
 }
 
 // If current token matches, consume it and return true
@@ -45,7 +78,7 @@ bool Parser::match(TokenType type) {
 }
 
 // Check if current token matches any of the given types
-bool Parser::match(vector<TokenType> types) {
+bool Parser::match(initializer_list<TokenType> types) {
     for (TokenType type : types) {
         if (check(type)) {
             advance();
@@ -57,12 +90,14 @@ bool Parser::match(vector<TokenType> types) {
 
 // ==================== Error Handling ====================
 
-void Parser::error(string message) {
-    Token token = peek();
-    cerr << "Parse Error at line " << token.line << ", column " << token.column 
-         << ": " << message << endl;
-    cerr << "  Found: " << tokenTypeToString(token.type) 
-         << " ('" << token.lexeme << "')" << endl;
+void Parser::error(const char* message) {
+    // Unwinding after the nesting limit must not cascade into more errors
+    if (abandoned) return;
+    
+    const Token& token = peek();
+    SourcePosition position = stream.positionOf(token);
+    string found = tokenTypeToString(token.type) + " ('" + token.text() + "')";
+    diagnostics.report(DiagnosticPhase::Parser, position.line, position.column, message, found);
     hadError = true;
 }
 
@@ -75,7 +110,7 @@ void Parser::synchronize() {
         if (previous().type == SEMICOLON) return;
         
         // Stop at keywords that start new statements
-        switch (peek().type) {
+        switch (peekType()) {
             case LINK:
             case TEXT:
             case DNUM:
@@ -97,134 +132,139 @@ void Parser::synchronize() {
     }
 }
 
-// ==================== Helper Methods ====================
-
-bool Parser::isDataType(TokenType type) {
-    return type == TEXT || type == DNUM || type == CNUM || type == FLAG;
-}
-
-bool Parser::isAddOp(TokenType type) {
-    return type == PLUS || type == MINUS || type == BITWISE_OR || 
-           type == BITWISE_AND || type == BITWISE_XOR;
-}
+// Holds one level of nesting for the lifetime of a grammar rule
+class NestingScope {
+private:
+    size_t& depth;
+    
+public:
+    NestingScope(size_t& counter) : depth(counter) { depth++; }
+    ~NestingScope() { depth--; }
+};
 
-bool Parser::isMulOp(TokenType type) {
-    return type == MULTIPLY || type == DIVIDE || type == MODULO || 
-           type == LEFT_SHIFT || type == RIGHT_SHIFT;
+// Report nesting beyond maxDepth once, then skip the rest of the input so
+// every rule on the stack unwinds straight to the end of the program
+bool Parser::nestingExceeded() {
+    if (depth <= maxDepth) return false;
+    
+    if (!abandoned) {
+        string message = "Nesting exceeds the maximum depth of " + to_string(maxDepth);
+        error(message.c_str());
+        abandoned = true;
+        while (!isAtEnd()) advance();
+    }
+    return true;
 }
 
-bool Parser::isRelOp(TokenType type) {
-    return type == EQ || type == NEQ || type == LT || 
-           type == GT || type == LTE || type == GTE;
-}
+// ==================== Helper Methods ====================
 
-bool Parser::isLogicalOp(TokenType type) {
-    return type == AND || type == OR;
+bool Parser::isDataType(TokenType type) {
+    return type == TEXT || type == DNUM || type == CNUM || type == FLAG;
 }
 
-bool Parser::isUnaryOp(TokenType type) {
-    return type == MINUS || type == NOT || type == BITWISE_NOT || 
-           type == INCREMENT || type == DECREMENT;
+// Quiet parsers leave reporting the outcome to the caller
+void Parser::reportOutcome() {
+    if (verbosity < 0) return;
+    if (!hadError) {
+        cout << "\n=== Parsing completed successfully! ===\n";
+    } else {
+        cout << "\n=== Parsing completed with errors ===\n";
+    }
 }
 
 // ==================== Grammar Rules ====================
 
 // Program → StatementList EOF
-void Parser::program() {
-    cout << "Parsing program..." << endl;
-    statementList();
+NodeId Parser::program() {
+    TRACE("Parsing program...");
+    NodeId root = ast.add(NodeKind::Program);
+    NodeId first = statementList();
+    ast.node(root).a = first;
     
     if (!isAtEnd()) {
         error("Expected end of file");
     }
     
-    if (!hadError) {
-        cout << "\n=== Parsing completed successfully! ===" << endl;
-    } else {
-        cout << "\n=== Parsing completed with errors ===" << endl;
-    }
+    reportOutcome();
+    return root;
 }
 
 // StatementList → Statement StatementList | ε
-void Parser::statementList() {
+NodeId Parser::statementList() {
+    NestingScope scope(depth);
+    if (nestingExceeded()) return NO_NODE;
+    
+    NodeList list;
+    
     // Keep parsing statements until we hit a stopping point
     while (!isAtEnd() && !check(RBRACE)) {
-        statement();
+        NodeId stmt = statement();
+        ast.append(list, stmt);
     }
+    return list.first;
 }
 
 // Statement → Declaration | Assignment | IfStmt | UntilStmt | ...
-void Parser::statement() {
+NodeId Parser::statement() {
     // Skip comments
     if (match(COMMENT)) {
-        return;
+        return NO_NODE;
     }
     
     // Link statement
     if (check(LINK)) {
-        linkStmt();
-        return;
+        return linkStmt();
     }
     
     // Declaration (starts with data type)
-    if (isDataType(peek().type)) {
-        declaration();
-        return;
+    if (isDataType(peekType())) {
+        return declaration();
     }
     
     // Control structures
     if (check(IF)) {
-        ifStmt();
-        return;
+        return ifStmt();
     }
     
     if (check(UNTIL)) {
-        untilStmt();
-        return;
+        return untilStmt();
     }
     
     if (check(ITERATE)) {
-        iterateStmt();
-        return;
+        return iterateStmt();
     }
     
     // Function definitions
     if (check(NETWORK)) {
-        networkStmt();
-        return;
+        return networkStmt();
     }
     
     if (check(INIT)) {
-        initStmt();
-        return;
+        return initStmt();
     }
     
     // I/O statements
     if (check(FEED)) {
-        feedStmt();
-        return;
+        return feedStmt();
     }
     
     if (check(FORWARD)) {
-        forwardStmt();
-        return;
+        return forwardStmt();
     }
     
     // Return statement
     if (check(YIELD)) {
-        returnStmt();
-        return;
+        return returnStmt();
     }
     
     // Assignment (starts with identifier)
     if (check(IDENTIFIER)) {
-        assignment();
-        return;
+        return assignment();
     }
     
     // Empty statement (just semicolon)
     if (match(SEMICOLON)) {
-        return;
+        return NO_NODE;
     }
     
     // If none match, it's an error
@@ -232,472 +272,669 @@ void Parser::statement() {
         error("Unexpected token in statement");
         synchronize();
     }
+    return NO_NODE;
 }
 
 // LinkStmt → link StringLiteral ;
-void Parser::linkStmt() {
-    cout << "Parsing link statement..." << endl;
+NodeId Parser::linkStmt() {
+    TRACE("Parsing link statement...");
     
     if (!match(LINK)) {
         error("Expected 'link'");
-        return;
+        return NO_NODE;
     }
     
     if (!match(STRING_LITERAL)) {
         error("Expected string literal after 'link'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Link, previous());
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after link statement");
         synchronize();
     }
+    return node;
 }
 
 // Declaration → DataType Identifier = Expr ; | DataType Identifier ;
-void Parser::declaration() {
-    cout << "Parsing declaration..." << endl;
+NodeId Parser::declaration() {
+    TRACE("Parsing declaration...");
     
     // Consume data type
     if (!match({TEXT, DNUM, CNUM, FLAG})) {
         error("Expected data type");
-        return;
+        return NO_NODE;
     }
     TokenType dataType = previous().type;
     
     // Consume identifier
     if (!match(IDENTIFIER)) {
         error("Expected identifier in declaration");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Declaration, previous());
+    ast.node(node).op = dataType;
     
     // Optional initialization
     if (match(ASSIGN)) {
-        expr();
+        NodeId value = expression();
+        ast.node(node).a = value;
     }
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after declaration");
         synchronize();
     }
+    return node;
 }
 
 // Assignment → Identifier = Expr ;
-void Parser::assignment() {
-    cout << "Parsing assignment..." << endl;
+NodeId Parser::assignment() {
+    TRACE("Parsing assignment...");
     
     if (!match(IDENTIFIER)) {
         error("Expected identifier in assignment");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Assign, previous());
     
     if (!match(ASSIGN)) {
         error("Expected '=' in assignment");
-        return;
+        return node;
     }
     
-    expr();
+    NodeId value = expression();
+    ast.node(node).a = value;
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after assignment");
         synchronize();
     }
+    return node;
 }
 
-// IfStmt → if ( Condition ) { StatementList } [ else { StatementList } ]
-void Parser::ifStmt() {
-    cout << "Parsing if statement..." << endl;
+// IfStmt → if ( Expr ) { StatementList } [ else { StatementList } ]
+NodeId Parser::ifStmt() {
+    TRACE("Parsing if statement...");
     
     if (!match(IF)) {
         error("Expected 'if'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::If, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after 'if'");
-        return;
+        return node;
     }
     
-    condition();
+    NodeId cond = expression();
+    ast.node(node).a = cond;
     
     if (!match(RPAREN)) {
         error("Expected ')' after condition");
-        return;
+        return node;
     }
     
     if (!match(LBRACE)) {
         error("Expected '{' after if condition");
-        return;
+        return node;
     }
     
-    statementList();
+    NodeId thenBody = statementList();
+    ast.node(node).b = thenBody;
     
     if (!match(RBRACE)) {
         error("Expected '}' after if body");
-        return;
+        return node;
     }
     
     // Optional else
     if (match(ELSE)) {
         if (!match(LBRACE)) {
             error("Expected '{' after 'else'");
-            return;
+            return node;
         }
         
-        statementList();
+        NodeId elseBody = statementList();
+        ast.node(node).c = elseBody;
         
         if (!match(RBRACE)) {
             error("Expected '}' after else body");
         }
     }
+    return node;
 }
 
-// UntilStmt → until ( Condition ) { StatementList }
-void Parser::untilStmt() {
-    cout << "Parsing until loop..." << endl;
+// UntilStmt → until ( Expr ) { StatementList }
+NodeId Parser::untilStmt() {
+    TRACE("Parsing until loop...");
     
     if (!match(UNTIL)) {
         error("Expected 'until'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Until, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after 'until'");
-        return;
+        return node;
     }
     
-    condition();
+    NodeId cond = expression();
+    ast.node(node).a = cond;
     
     if (!match(RPAREN)) {
         error("Expected ')' after condition");
-        return;
+        return node;
     }
     
     if (!match(LBRACE)) {
         error("Expected '{' after until condition");
-        return;
+        return node;
     }
     
-    statementList();
+    NodeId body = statementList();
+    ast.node(node).b = body;
     
     if (!match(RBRACE)) {
         error("Expected '}' after until body");
     }
+    return node;
 }
 
-// IterateStmt → iterate ( Declaration ; Condition ; Assignment ) { StatementList }
-void Parser::iterateStmt() {
-    cout << "Parsing iterate loop..." << endl;
+// IterateStmt → iterate ( Declaration ; Expr ; Assignment ) { StatementList }
+NodeId Parser::iterateStmt() {
+    TRACE("Parsing iterate loop...");
     
     if (!match(ITERATE)) {
         error("Expected 'iterate'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Iterate, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after 'iterate'");
-        return;
+        return node;
     }
     
     // Initialization (declaration without semicolon check in declaration())
-    if (isDataType(peek().type)) {
+    if (isDataType(peekType())) {
         match({TEXT, DNUM, CNUM, FLAG});
+        TokenType dataType = previous().type;
         if (!match(IDENTIFIER)) {
             error("Expected identifier in iterate initialization");
+        } else {
+            NodeId init = ast.add(NodeKind::Declaration, previous());
+            ast.node(init).op = dataType;
+            ast.node(node).a = init;
         }
         if (match(ASSIGN)) {
-            expr();
+            NodeId value = expression();
+            if (ast.node(node).a != NO_NODE) ast.node(ast.node(node).a).a = value;
         }
     }
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after iterate initialization");
-        return;
+        return node;
     }
     
     // Condition
-    condition();
+    NodeId cond = expression();
+    ast.node(node).b = cond;
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after iterate condition");
-        return;
+        return node;
     }
     
     // Update (assignment without semicolon)
     if (match(IDENTIFIER)) {
+        NodeId update = ast.add(NodeKind::Assign, previous());
+        ast.node(node).c = update;
         if (!match(ASSIGN)) {
             error("Expected '=' in iterate update");
         }
-        expr();
+        NodeId value = expression();
+        ast.node(update).a = value;
     }
     
     if (!match(RPAREN)) {
         error("Expected ')' after iterate clauses");
-        return;
+        return node;
     }
     
     if (!match(LBRACE)) {
         error("Expected '{' after iterate header");
-        return;
+        return node;
     }
     
-    statementList();
+    NodeId body = statementList();
+    ast.node(node).d = body;
     
     if (!match(RBRACE)) {
         error("Expected '}' after iterate body");
     }
+    return node;
 }
 
 // NetworkStmt → network Identifier ( ParameterList ) { StatementList }
-void Parser::networkStmt() {
-    cout << "Parsing network function..." << endl;
+NodeId Parser::networkStmt() {
+    TRACE("Parsing network function...");
     
     if (!match(NETWORK)) {
         error("Expected 'network'");
-        return;
+        return NO_NODE;
     }
     
     if (!match(IDENTIFIER)) {
         error("Expected function name after 'network'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Network, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after function name");
-        return;
+        return node;
     }
     
     // Parameters (if any)
     if (!check(RPAREN)) {
-        parameterList();
+        NodeList params = parameterList();
+        ast.node(node).a = params.first;
+        ast.node(node).count = params.count;
     }
     
     if (!match(RPAREN)) {
         error("Expected ')' after parameters");
-        return;
+        return node;
     }
     
     if (!match(LBRACE)) {
         error("Expected '{' after function header");
-        return;
+        return node;
     }
     
-    statementList();
+    NodeId body = statementList();
+    ast.node(node).b = body;
     
     if (!match(RBRACE)) {
         error("Expected '}' after function body");
     }
+    return node;
 }
 
 // InitStmt → init ( ) { StatementList }
-void Parser::initStmt() {
-    cout << "Parsing init function..." << endl;
+NodeId Parser::initStmt() {
+    TRACE("Parsing init function...");
     
     if (!match(INIT)) {
         error("Expected 'init'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Init, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after 'init'");
-        return;
+        return node;
     }
     
     if (!match(RPAREN)) {
         error("Expected ')' after 'init'");
-        return;
+        return node;
     }
     
     if (!match(LBRACE)) {
         error("Expected '{' after init header");
-        return;
+        return node;
     }
     
-    statementList();
+    NodeId body = statementList();
+    ast.node(node).a = body;
     
     if (!match(RBRACE)) {
         error("Expected '}' after init body");
     }
+    return node;
 }
 
 // ParameterList → DataType Identifier [ , DataType Identifier ]*
-void Parser::parameterList() {
+// Past MAX_LIST_LENGTH the parameters are still parsed, but not kept
+NodeList Parser::parameterList() {
+    NodeList params;
+    bool reported = false;
     do {
+        if (params.count == MAX_LIST_LENGTH && !reported) {
+            string message = "Too many parameters (at most " + to_string(MAX_LIST_LENGTH) + ")";
+            error(message.c_str());
+            reported = true;
+        }
         if (!match({TEXT, DNUM, CNUM, FLAG})) {
             error("Expected data type in parameter list");
-            return;
+            return params;
         }
+        TokenType dataType = previous().type;
         
         if (!match(IDENTIFIER)) {
             error("Expected parameter name");
-            return;
+            return params;
         }
+        NodeId param = ast.add(NodeKind::Param, previous());
+        ast.node(param).op = dataType;
+        if (params.count < MAX_LIST_LENGTH) ast.append(params, param);
     } while (match(COMMA));
+    return params;
 }
 
 // ArgumentList → Expr [ , Expr ]*
-void Parser::argumentList() {
+// Past MAX_LIST_LENGTH the arguments are still parsed, but not kept
+NodeList Parser::argumentList() {
+    NodeList args;
+    bool reported = false;
     do {
-        expr();
+        if (args.count == MAX_LIST_LENGTH && !reported) {
+            string message = "Too many arguments (at most " + to_string(MAX_LIST_LENGTH) + ")";
+            error(message.c_str());
+            reported = true;
+        }
+        NodeId arg = expression();
+        if (args.count < MAX_LIST_LENGTH) ast.append(args, arg);
     } while (match(COMMA));
+    return args;
 }
 
 // ReturnStmt → yield Expr ;
-void Parser::returnStmt() {
-    cout << "Parsing return statement..." << endl;
+NodeId Parser::returnStmt() {
+    TRACE("Parsing return statement...");
     
     if (!match(YIELD)) {
         error("Expected 'yield'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Yield, previous());
     
-    expr();
+    NodeId value = expression();
+    ast.node(node).a = value;
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after return statement");
         synchronize();
     }
+    return node;
 }
 
 // FeedStmt → feed Identifier ;
-void Parser::feedStmt() {
-    cout << "Parsing feed statement..." << endl;
+NodeId Parser::feedStmt() {
+    TRACE("Parsing feed statement...");
     
     if (!match(FEED)) {
         error("Expected 'feed'");
-        return;
+        return NO_NODE;
     }
     
     if (!match(IDENTIFIER)) {
         error("Expected identifier after 'feed'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Feed, previous());
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after feed statement");
         synchronize();
     }
+    return node;
 }
 
 // ForwardStmt → forward ( Expr ) ;
-void Parser::forwardStmt() {
-    cout << "Parsing forward statement..." << endl;
+NodeId Parser::forwardStmt() {
+    TRACE("Parsing forward statement...");
     
     if (!match(FORWARD)) {
         error("Expected 'forward'");
-        return;
+        return NO_NODE;
     }
+    NodeId node = ast.add(NodeKind::Forward, previous());
     
     if (!match(LPAREN)) {
         error("Expected '(' after 'forward'");
-        return;
+        return node;
     }
     
-    expr();
+    NodeId value = expression();
+    ast.node(node).a = value;
     
     if (!match(RPAREN)) {
         error("Expected ')' after expression");
-        return;
+        return node;
     }
     
     if (!match(SEMICOLON)) {
         error("Expected ';' after forward statement");
         synchronize();
     }
+    return node;
 }
 
-// Condition → Expr RelOp Expr | Expr LogicalOp Expr | ! Condition | ( Condition )
-void Parser::condition() {
-    // Handle NOT operator
-    if (match(NOT)) {
-        condition();
-        return;
-    }
+// Expression → Unary [ BinaryOp Unary ]*, grouped by operatorTable
+// Operators that bind tighter than the one just read are folded into its
+// right operand by the recursive call and the loop handles the rest, so an
+// operand costs one call however many precedence levels there are.
+NodeId Parser::expression(int minPrecedence) {
+    NodeId left = unary();
     
-    // Handle parenthesized condition
-    if (match(LPAREN)) {
-        condition();
-        if (!match(RPAREN)) {
-            error("Expected ')' after condition");
-        }
-        return;
-    }
-    
-    // Standard: Expr RelOp Expr or Expr LogicalOp Expr
-    expr();
-    
-    if (isRelOp(peek().type) || isLogicalOp(peek().type)) {
-        advance();
-        expr();
-    }
-}
-
-// Expr → Term [ AddOp Term ]*
-void Parser::expr() {
-    term();
-    
-    while (isAddOp(peek().type)) {
-        advance();
-        term();
+    for (;;) {
+        TokenType type = peekType();
+        int precedence = operatorTable.binary[type];
+        if (precedence < minPrecedence) break;    // PREC_NONE is always below
+        
+        Token op = advance();
+        NodeId right = expression(operatorTable.rightAssoc[type] ? precedence : precedence + 1);
+        left = binary(op, left, right);
     }
+    return left;
 }
 
-// Term → Factor [ MulOp Factor ]*
-void Parser::term() {
-    factor();
-    
-    while (isMulOp(peek().type)) {
-        advance();
-        factor();
+// Unary → UnaryOp Unary | Primary
+NodeId Parser::unary() {
+    if (operatorTable.prefix[peekType()]) {
+        NestingScope scope(depth);
+        if (nestingExceeded()) return NO_NODE;
+        
+        const Token& op = advance();
+        NodeId node = ast.add(NodeKind::Unary, op);
+        ast.node(node).op = op.type;
+        NodeId operand = unary();
+        ast.node(node).a = operand;
+        return node;
     }
+    return primary();
 }
 
-// Factor → Number | Identifier | String | ( Expr ) | UnaryOp Factor | FunctionCall
-void Parser::factor() {
-    // Unary operators
-    if (isUnaryOp(peek().type)) {
-        advance();
-        factor();
-        return;
-    }
-    
+// Primary → Number | Identifier | String | ( Expr ) | FunctionCall
+NodeId Parser::primary() {
     // Literals
     if (match({INTEGER_LITERAL, FLOAT_LITERAL, STRING_LITERAL, BOOLEAN_LITERAL})) {
-        return;
+        return literal(previous());
     }
     
     // Identifier or function call
     if (match(IDENTIFIER)) {
-        // Check for function call
+        NodeId node = ast.add(NodeKind::Identifier, previous());
+        
+        // Check for function call; arguments nest like parentheses
         if (match(LPAREN)) {
+            NestingScope scope(depth);
+            if (nestingExceeded()) return NO_NODE;
+            
+            ast.node(node).kind = NodeKind::Call;
             if (!check(RPAREN)) {
-                argumentList();
+                NodeList args = argumentList();
+                ast.node(node).a = args.first;
+                ast.node(node).count = args.count;
             }
             if (!match(RPAREN)) {
                 error("Expected ')' after arguments");
             }
         }
-        return;
+        return node;
     }
     
     // Parenthesized expression
     if (match(LPAREN)) {
-        expr();
+        NestingScope scope(depth);
+        if (nestingExceeded()) return NO_NODE;
+        
+        NodeId inner = expression();
         if (!match(RPAREN)) {
             error("Expected ')' after expression");
         }
-        return;
+        return inner;
     }
     
     error("Expected expression");
+    return NO_NODE;
+}
+
+// Build a literal node, decoding numeric and boolean values once
+NodeId Parser::literal(const Token& token) {
+    const char* first = token.lexeme.data();
+    const char* last = first + token.lexeme.size();
+    NodeId node;
+    
+    switch (token.type) {
+        case INTEGER_LITERAL: {
+            int64_t value = 0;
+            from_chars(first, last, value);
+            node = ast.add(NodeKind::IntLiteral, token);
+            ast.setInt(node, value);
+            break;
+        }
+        case FLOAT_LITERAL: {
+            double value = 0;
+            from_chars(first, last, value);
+            node = ast.add(NodeKind::FloatLiteral, token);
+            ast.setFloat(node, value);
+            break;
+        }
+        case BOOLEAN_LITERAL:
+            node = ast.add(NodeKind::BoolLiteral, token);
+            ast.node(node).a = token.lexeme == "true";
+            break;
+        default:
+            node = ast.add(NodeKind::StringLiteral, token);
+            break;
+    }
+    return node;
+}
+
+// Build a binary node over two already built operands
+NodeId Parser::binary(const Token& op, NodeId left, NodeId right) {
+    NodeId node = ast.add(NodeKind::Binary, op);
+    ast.node(node).op = op.type;
+    ast.node(node).a = left;
+    ast.node(node).b = right;
+    return node;
 }
 
 // ==================== Public Methods ====================
 
 void Parser::parse() {
-    program();
+    // Roughly one node per 16 bytes of source
+    string_view source = stream.sourceText();
+    ast.reset(source, source.size() / 16);
+    ast.setRoot(program());
+}
+
+size_t Parser::nextTopLevelStart(const TokenBuffer& tokens, size_t from, size_t end) {
+    const uint8_t* types = tokens.typeArray();
+    int braces = 0;
+    
+    for (size_t i = from; i < end; i++) {
+        switch (types[i]) {
+            case LBRACE:
+                braces++;
+                break;
+            case RBRACE:
+                // Closes the top-level statement list: nothing after it
+                // starts a top-level statement
+                if (braces == 0) return end;
+                braces--;
+                break;
+            case NETWORK:
+            case INIT:
+            case LINK:
+                if (braces == 0) return i;
+                break;
+        }
+    }
+    return end;
+}
+
+void Parser::parseParallel(unsigned jobs, size_t minSegment) {
+    const TokenBuffer* tokens = stream.tokenBuffer();
+    TaskPool pool(jobs);
+    if (!tokens || pool.workerCount() < 2) {
+        parse();
+        return;
+    }
+    
+    // Cut before top-level network, init and link statements, at least
+    // minSegment tokens apart
+    size_t end = tokens->size() - 1;
+    vector<size_t> cuts(1, 0);
+    for (size_t i = nextTopLevelStart(*tokens, 0, end); i < end; 
+         i = nextTopLevelStart(*tokens, i + 1, end)) {
+        if (i - cuts.back() >= minSegment) cuts.push_back(i);
+    }
+    cuts.push_back(end);
+    size_t count = cuts.size() - 1;
+    
+    // Runs that report errors look up positions in the shared line index,
+    // which builds itself on first use: build it here, before they start
+    tokens->lineIndex().lineStarts();
+    
+    vector<unique_ptr<Parser>> runs(count);
+    pool.run(count, [&](size_t i) {
+        Parser& run = *(runs[i] = unique_ptr<Parser>(new Parser(*tokens, cuts[i], cuts[i + 1])));
+        run.maxDepth = maxDepth;
+        run.ast.reset(tokens->text(), (cuts[i + 1] - cuts[i]) / 2);
+        run.ast.setRoot(run.program());
+    });
+    
+    // A run that parsed cleanly ended exactly at its cut, where parse()
+    // would also be at the top level with nothing pending. From the first
+    // run with an error on, parse sequentially to the end instead.
+    size_t clean = 0;
+    while (clean < count && !runs[clean]->hadError) clean++;
+    if (clean < count) {
+        runs.resize(clean + 1);
+        runs[clean] = unique_ptr<Parser>(new Parser(*tokens, cuts[clean], end));
+        Parser& rest = *runs[clean];
+        rest.maxDepth = maxDepth;
+        rest.ast.reset(tokens->text(), (end - cuts[clean]) / 2);
+        rest.ast.setRoot(rest.program());
+    }
+    
+    // Join the trees under one Program node, in source order
+    size_t nodes = 1;
+    for (const auto& run : runs) nodes += run->ast.size() - 1;
+    ast.reset(tokens->text(), nodes);
+    NodeId root = ast.add(NodeKind::Program);
+    NodeList statements;
+    for (const auto& run : runs) {
+        for (NodeId stmt = ast.graft(run->ast); stmt != NO_NODE; stmt = ast.node(stmt).next) {
+            ast.append(statements, stmt);
+        }
+        diagnostics.append(run->diagnostics);
+        hadError = hadError || run->hadError;
+    }
+    ast.node(root).a = statements.first;
+    ast.setRoot(root);
+    reportOutcome();
 }
 
 bool Parser::hasError() {
     return hadError;
-}
\ No newline at end of file
+}
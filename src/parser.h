@@ -3,64 +3,119 @@
 
 #include <vector>
 #include <string>
+#include <initializer_list>
 #include "token.h"
+#include "token_stream.h"
+#include "ast.h"
+#include "precedence.h"
+#include "diagnostics.h"
 
 using namespace std;
 
 // Parser class - performs syntax analysis on NetC token stream
 class Parser {
 private:
-    vector<Token> tokens;       // List of tokens from scanner
-    int current;                // Current token position
+    TokenStream stream;         // Token source (list or streaming scanner)
     bool hadError;              // Track if any errors occurred
+    size_t depth;               // Current block/expression nesting
+    size_t maxDepth;            // Deepest nesting accepted
+    bool abandoned;             // Nesting limit hit; rest of input skipped
+    int verbosity;              // stdout output level (see setVerbosity)
+    Diagnostics diagnostics;    // Syntax errors, in source order
+    Ast ast;                    // Tree built by the grammar rules
     
     // Utility methods
-    Token peek();               // Look at current token
-    Token previous();           // Look at previous token
-    Token advance();            // Consume and return current token
+    TokenType peekType();       // Type of current token (no materialization)
+    const Token& peek();        // Look at current token
+    const Token& previous();    // Look at previous token
+    const Token& advance();     // Consume and return current token
     bool isAtEnd();            // Check if at end of tokens
     bool check(TokenType type); // Check if current token is of type
     bool match(TokenType type); // Check and consume if matches
-    bool match(vector<TokenType> types); // Check multiple types
+    bool match(initializer_list<TokenType> types); // Check multiple types
     
     // Error handling
-    void error(string message);
+    void error(const char* message);
     void synchronize();         // Recover from errors
+    bool nestingExceeded();     // Check depth, abandoning the parse past maxDepth
     
     // Grammar rules - one function per non-terminal
-    void program();
-    void statementList();
-    void statement();
-    void linkStmt();
-    void declaration();
-    void assignment();
-    void ifStmt();
-    void untilStmt();
-    void iterateStmt();
-    void networkStmt();
-    void initStmt();
-    void returnStmt();
-    void feedStmt();
-    void forwardStmt();
-    void parameterList();
-    void argumentList();
-    void condition();
-    void expr();
-    void term();
-    void factor();
+    // Each returns the node it built (NO_NODE if nothing was built)
+    NodeId program();
+    NodeId statementList();     // Returns the first statement of the list
+    NodeId statement();
+    NodeId linkStmt();
+    NodeId declaration();
+    NodeId assignment();
+    NodeId ifStmt();
+    NodeId untilStmt();
+    NodeId iterateStmt();
+    NodeId networkStmt();
+    NodeId initStmt();
+    NodeId returnStmt();
+    NodeId feedStmt();
+    NodeId forwardStmt();
+    NodeList parameterList();
+    NodeList argumentList();
+    NodeId expression(int minPrecedence = PREC_OR);  // Pratt loop over operatorTable
+    NodeId unary();
+    NodeId primary();
+    NodeId literal(const Token& token);
+    NodeId binary(const Token& op, NodeId left, NodeId right);
     
     // Helper methods
     bool isDataType(TokenType type);
-    bool isAddOp(TokenType type);
-    bool isMulOp(TokenType type);
-    bool isRelOp(TokenType type);
-    bool isLogicalOp(TokenType type);
-    bool isUnaryOp(TokenType type);
+    void reportOutcome();       // Final result line (at verbosity 0 and up)
+    
+    // Parse tokens [first, last) of a buffer as a whole program
+    Parser(const TokenBuffer& tokens, size_t first, size_t last);
+    
+    friend class EditSession;   // Reparses single definitions
     
 public:
-    Parser(vector<Token> tokens);
+    Parser(const vector<Token>& tokens, const LineIndex& lines);  // Must outlive the parser
+    Parser(const TokenBuffer& tokens);    // Struct-of-arrays tokens
+    Parser(Scanner& scanner);  // Parse while scanning, without a token list
+    
+    // Number of tokens the parser has consumed
+    size_t tokenCount() const { return stream.count(); }
+    // Nesting of blocks, parentheses, call arguments and prefix operators
+    // is limited so adversarial input gets an error instead of overflowing
+    // the stack
+    static const size_t DEFAULT_MAX_DEPTH = 4096;
+    void setMaxDepth(size_t limit) { maxDepth = limit; }
+    
+    // Smallest run of tokens parseParallel hands to a thread
+    static const size_t MIN_SEGMENT_TOKENS = 16384;
+    
+    // Output on stdout: below 0 nothing, 0 the final result line, 1 and
+    // above also a trace of each grammar rule (debug builds only; release
+    // builds compile the trace out)
+    void setVerbosity(int level) { verbosity = level; }
+    
     void parse();              // Main parsing method
+    
+    // Same result as parse() for a TokenBuffer, on up to `jobs` threads
+    // (0 = one per hardware thread). A brace-matching pass over the token
+    // types finds the top-level network, init and link statements; runs
+    // of them are parsed by separate parsers and the trees and errors are
+    // joined in source order. From the first run with an error on, the
+    // rest is parsed sequentially, so recovery matches parse(). The rule
+    // trace is not printed.
+    void parseParallel(unsigned jobs, size_t minSegment = MIN_SEGMENT_TOKENS);
+    
+    // Brace-matching pass used to split a program: index of the first
+    // network, init or link token at brace depth 0 in tokens [from, end),
+    // counting depth from 0 at from. Returns end if there is none, or if a
+    // '}' closes more braces than were opened (that ends the top-level
+    // statement list, so nothing after it is a top-level statement).
+    static size_t nextTopLevelStart(const TokenBuffer& tokens, size_t from, size_t end);
     bool hasError();           // Check if parsing had errors
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    
+    // Tree from the last parse(); node text points into the source
+    const Ast& getAst() const { return ast; }
+    Ast& getAst() { return ast; }
 };
 
 #endif // PARSER_H
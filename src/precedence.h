@@ -0,0 +1,58 @@
+#ifndef PRECEDENCE_H
+#define PRECEDENCE_H
+
+#include <cstdint>
+#include "token.h"
+
+using namespace std;
+
+// Binding power of expression operators, lowest to highest (C order)
+enum Precedence : uint8_t {
+    PREC_NONE,              // Not a binary operator
+    PREC_OR,                // ||
+    PREC_AND,               // &&
+    PREC_BITWISE_OR,        // |
+    PREC_BITWISE_XOR,       // ^
+    PREC_BITWISE_AND,       // &
+    PREC_EQUALITY,          // == !=
+    PREC_RELATIONAL,        // < > <= >=
+    PREC_SHIFT,             // << >>
+    PREC_ADDITIVE,          // + -
+    PREC_MULTIPLICATIVE,    // * / %
+    PREC_UNARY              // - ! ~ ++ -- (prefix)
+};
+
+constexpr int TOKEN_TYPE_COUNT = UNKNOWN + 1;
+
+// Operator table for the Pratt expression parser, indexed by TokenType
+// binary[t] is the precedence of t as an infix operator (PREC_NONE if it
+// is not one), rightAssoc[t] says whether it groups to the right, and
+// prefix[t] marks the unary prefix operators.
+struct OperatorTable {
+    uint8_t binary[TOKEN_TYPE_COUNT];
+    bool rightAssoc[TOKEN_TYPE_COUNT];
+    bool prefix[TOKEN_TYPE_COUNT];
+    
+    constexpr OperatorTable() : binary(), rightAssoc(), prefix() {
+        binary[OR] = PREC_OR;
+        binary[AND] = PREC_AND;
+        binary[BITWISE_OR] = PREC_BITWISE_OR;
+        binary[BITWISE_XOR] = PREC_BITWISE_XOR;
+        binary[BITWISE_AND] = PREC_BITWISE_AND;
+        binary[EQ] = binary[NEQ] = PREC_EQUALITY;
+        binary[LT] = binary[GT] = binary[LTE] = binary[GTE] = PREC_RELATIONAL;
+        binary[LEFT_SHIFT] = binary[RIGHT_SHIFT] = PREC_SHIFT;
+        binary[PLUS] = binary[MINUS] = PREC_ADDITIVE;
+        binary[MULTIPLY] = binary[DIVIDE] = binary[MODULO] = PREC_MULTIPLICATIVE;
+        
+        prefix[MINUS] = prefix[NOT] = prefix[BITWISE_NOT] = true;
+        prefix[INCREMENT] = prefix[DECREMENT] = true;
+    }
+};
+
+constexpr OperatorTable operatorTable;
+
+static_assert(operatorTable.binary[MULTIPLY] > operatorTable.binary[PLUS], "precedence order");
+static_assert(operatorTable.binary[END_OF_FILE] == PREC_NONE, "end of input stops expressions");
+
+#endif // PRECEDENCE_H
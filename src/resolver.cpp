@@ -0,0 +1,265 @@
+#include "resolver.h"
+#include <algorithm>
+
+using namespace std;
+
+// Scope depth of the program's top-level declarations
+static const uint32_t GLOBAL_SCOPE = 1;
+
+Resolver::Resolver(const Ast& tree, const Interner& names, const LineIndex& index)
+    : ast(tree), interner(names), lines(index),
+      innermost(names.size() + 1, 0), networks(names.size() + 1, NO_NODE),
+      linkedNetworks(names.size() + 1, -1), targets(tree.size() + 1, NO_NODE),
+      entry(NO_NODE), bodyScope(GLOBAL_SCOPE), hasLinks(false), linksLoaded(false), references(0) {}
+
+void Resolver::addLinkedNetworks(const Ast& module) {
+    for (NodeId id = 1; id <= module.size(); id++) {
+        if (module.node(id).kind != NodeKind::Network) continue;
+        
+        // The module has its own interner; a name this program never
+        // mentions cannot be called by it
+        SymbolId symbol = interner.find(module.text(id));
+        if (symbol != NO_SYMBOL) linkedNetworks[symbol] = module.node(id).count;
+    }
+}
+
+void Resolver::error(NodeId at, const string& message) {
+    const Node& node = ast.node(at);
+    SourcePosition position = lines.position(node.offset, node.length);
+    diagnostics.report(DiagnosticPhase::Semantic, position.line, position.column, message);
+}
+
+// Networks can be called before their definition, so they are all
+// declared up front. Nodes are in source order, so the first of several
+// definitions is the one kept (the others are reported when reached).
+void Resolver::collectNetworks() {
+    for (NodeId id = 1; id <= ast.size(); id++) {
+        const Node& node = ast.node(id);
+        if (node.kind == NodeKind::Link) {
+            hasLinks = true;
+        } else if (node.kind == NodeKind::Init) {
+            if (entry == NO_NODE) entry = id;
+        } else if (node.kind == NodeKind::Network) {
+            if (networks[ast.symbol(id)] == NO_NODE) networks[ast.symbol(id)] = id;
+        }
+    }
+}
+
+// ==================== Scopes ====================
+
+void Resolver::openScope() {
+    marks.push_back(bindings.size());
+}
+
+// Pop the scope's bindings, uncovering the ones they hid
+void Resolver::closeScope() {
+    while (bindings.size() > marks.back()) {
+        const Binding& binding = bindings.back();
+        innermost[binding.symbol] = binding.hidden;
+        bindings.pop_back();
+    }
+    marks.pop_back();
+}
+
+void Resolver::declare(NodeId id) {
+    SymbolId symbol = ast.symbol(id);
+    uint32_t visible = innermost[symbol];
+    uint32_t scope = marks.size();
+    
+    if (visible != 0 && bindings[visible - 1].scope == scope) {
+        error(id, "'" + string(ast.text(id)) + "' is already declared in this scope");
+        return;
+    }
+    bindings.push_back({symbol, id, visible, scope});
+    innermost[symbol] = bindings.size();
+}
+
+// Declaration a use sees: the innermost binding of its name, skipping
+// locals of scopes outside the current network/init body
+NodeId Resolver::lookup(SymbolId symbol) const {
+    for (uint32_t at = innermost[symbol]; at != 0; at = bindings[at - 1].hidden) {
+        const Binding& binding = bindings[at - 1];
+        if (binding.scope == GLOBAL_SCOPE || binding.scope >= bodyScope) return binding.declaration;
+    }
+    return NO_NODE;
+}
+
+// ==================== Traversal ====================
+
+void Resolver::resolve() {
+    collectNetworks();
+    openScope();
+    statements(ast.node(ast.getRoot()).a);
+    closeScope();
+}
+
+// Variable use: Identifier, Assign target or Feed target
+void Resolver::use(NodeId id) {
+    SymbolId symbol = ast.symbol(id);
+    NodeId declaration = lookup(symbol);
+    references++;
+    
+    if (declaration != NO_NODE) {
+        targets[id] = declaration;
+    } else if (networks[symbol] != NO_NODE || linkedNetworks[symbol] >= 0) {
+        error(id, "'" + string(ast.text(id)) + "' is a network, not a variable");
+    } else {
+        error(id, "Undeclared variable '" + string(ast.text(id)) + "'");
+    }
+}
+
+// Checks a call whose arguments have been resolved
+void Resolver::call(NodeId id) {
+    const Node& node = ast.node(id);
+    SymbolId symbol = ast.symbol(id);
+    NodeId network = networks[symbol];
+    references++;
+    
+    // The lists themselves are counted, not the nodes' 16-bit counts
+    size_t arguments = 0;
+    for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) {
+        arguments++;
+    }
+    
+    size_t parameters;
+    if (network != NO_NODE) {
+        targets[id] = network;
+        parameters = 0;
+        for (NodeId param = ast.node(network).a; param != NO_NODE; param = ast.node(param).next) {
+            parameters++;
+        }
+    } else if (linkedNetworks[symbol] >= 0) {
+        parameters = linkedNetworks[symbol];
+    } else {
+        // Without the linked modules, any network may be one of theirs
+        if (!hasLinks || linksLoaded) {
+            error(id, "Call to unknown network '" + string(ast.text(id)) + "'");
+        }
+        return;
+    }
+    
+    if (arguments != parameters) {
+        error(id, "Network '" + string(ast.text(id)) + "' expects " + to_string(parameters) +
+                  (parameters == 1 ? " argument" : " arguments") + ", got " + to_string(arguments));
+    }
+}
+
+void Resolver::statements(NodeId first) {
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) {
+        statement(id);
+    }
+}
+
+void Resolver::statement(NodeId id) {
+    const Node& node = ast.node(id);
+    uint32_t outerBody = bodyScope;
+    
+    switch (node.kind) {
+        case NodeKind::Network:
+            if (networks[ast.symbol(id)] != id) {
+                error(id, "Network '" + string(ast.text(id)) + "' is already defined");
+            }
+            openScope();
+            bodyScope = marks.size();
+            for (NodeId param = node.a; param != NO_NODE; param = ast.node(param).next) {
+                declare(param);
+            }
+            statements(node.b);
+            bodyScope = outerBody;
+            closeScope();
+            break;
+        case NodeKind::Init:
+            if (entry != id) error(id, "init() is already defined");
+            openScope();
+            bodyScope = marks.size();
+            statements(node.a);
+            bodyScope = outerBody;
+            closeScope();
+            break;
+        case NodeKind::Declaration:
+            // The initializer cannot see the name it initializes
+            if (node.a != NO_NODE) expression(node.a);
+            declare(id);
+            break;
+        case NodeKind::Assign:
+            use(id);
+            if (node.a != NO_NODE) expression(node.a);
+            break;
+        case NodeKind::Feed:
+            use(id);
+            break;
+        case NodeKind::If:
+            expression(node.a);
+            openScope();
+            statements(node.b);
+            closeScope();
+            openScope();
+            statements(node.c);
+            closeScope();
+            break;
+        case NodeKind::Until:
+            expression(node.a);
+            openScope();
+            statements(node.b);
+            closeScope();
+            break;
+        case NodeKind::Iterate:
+            openScope();
+            if (node.a != NO_NODE) statement(node.a);
+            if (node.b != NO_NODE) expression(node.b);
+            if (node.c != NO_NODE) statement(node.c);
+            statements(node.d);
+            closeScope();
+            break;
+        case NodeKind::Forward:
+        case NodeKind::Yield:
+            if (node.a != NO_NODE) expression(node.a);
+            break;
+        default:
+            break;
+    }
+}
+
+// Binary chains are as long as the source makes them, so the operands
+// wait on an explicit stack rather than the native one. They are visited
+// left to right, and a call is checked after its arguments.
+void Resolver::expression(NodeId id) {
+    if (id == NO_NODE) return;
+    pending.clear();
+    pending.push_back({id, false});
+    
+    while (!pending.empty()) {
+        NodeId current = pending.back().first;
+        bool operandsDone = pending.back().second;
+        pending.pop_back();
+        const Node& node = ast.node(current);
+        
+        switch (node.kind) {
+            case NodeKind::Identifier:
+                use(current);
+                break;
+            case NodeKind::Call: {
+                if (operandsDone) {
+                    call(current);
+                    break;
+                }
+                pending.push_back({current, true});
+                size_t firstArg = pending.size();
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) {
+                    pending.push_back({arg, false});
+                }
+                reverse(pending.begin() + firstArg, pending.end());
+                break;
+            }
+            case NodeKind::Unary:
+                if (node.a != NO_NODE) pending.push_back({node.a, false});
+                break;
+            case NodeKind::Binary:
+                if (node.b != NO_NODE) pending.push_back({node.b, false});
+                if (node.a != NO_NODE) pending.push_back({node.a, false});
+                break;
+            default:
+                break;
+        }
+    }
+}
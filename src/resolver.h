@@ -0,0 +1,92 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ast.h"
+#include "diagnostics.h"
+#include "interner.h"
+#include "line_index.h"
+
+using namespace std;
+
+// Resolver - binds every name use of a parsed program to its declaration
+// Reports undeclared variables, calls to unknown networks, calls with the
+// wrong number of arguments and names declared twice in one scope.
+// Networks are global and may be called before they are defined; a
+// variable is visible from its declaration to the end of its block, and
+// inside a network or init body only its own locals and the program's
+// top-level declarations are visible. Parameters share the body's scope,
+// and an iterate header shares its body's.
+// The scope chain is one flat stack of bindings with a mark per open
+// scope. innermost[symbol] is the binding a use sees, and each binding
+// remembers the one it hides, so declaring, looking up and closing a scope
+// are all constant time per name: one pass over the tree, linear in its
+// size, with no map per block. Expressions are walked with an explicit
+// stack, so no input can overflow the native one.
+class Resolver {
+private:
+    struct Binding {
+        SymbolId symbol;
+        NodeId declaration;     // Declaration or Param node
+        uint32_t hidden;        // Binding it hides (index + 1, 0 if none)
+        uint32_t scope;         // Depth of the scope that declared it
+    };
+    
+    const Ast& ast;
+    const Interner& interner;
+    const LineIndex& lines;
+    Diagnostics diagnostics;
+    
+    vector<Binding> bindings;       // Scope chain, innermost last
+    vector<uint32_t> marks;         // bindings.size() when each scope opened
+    vector<uint32_t> innermost;     // By symbol: visible binding (index + 1)
+    vector<NodeId> networks;        // By symbol: Network node
+    vector<int32_t> linkedNetworks; // By symbol: parameter count (-1 if none)
+    vector<NodeId> targets;         // By node: what a use resolved to
+    vector<pair<NodeId, bool>> pending; // Expression walk: node, operands done
+    NodeId entry;                   // First init() definition
+    uint32_t bodyScope;             // Depth of the innermost network/init scope
+    bool hasLinks;                  // Program contains link statements
+    bool linksLoaded;               // Linked networks were all added
+    size_t references;              // Name uses resolved
+    
+    void error(NodeId at, const string& message);
+    void collectNetworks();
+    void openScope();
+    void closeScope();
+    void declare(NodeId id);
+    NodeId lookup(SymbolId symbol) const;
+    void use(NodeId id);
+    void call(NodeId id);
+    void statements(NodeId first);
+    void statement(NodeId id);
+    void expression(NodeId id);
+    
+public:
+    // The tree's symbols must come from interner
+    Resolver(const Ast& ast, const Interner& interner, const LineIndex& lines);
+    
+    // Networks defined in the tree of a linked module. Calls to them are
+    // checked like calls to the program's own (which win on a name clash).
+    void addLinkedNetworks(const Ast& module);
+    
+    // Say that every linked network has been added. Until then, a program
+    // with link statements may call networks it does not define.
+    void setLinksLoaded(bool loaded) { linksLoaded = loaded; }
+    
+    // Resolve the whole tree (once)
+    void resolve();
+    
+    // Declaration or Param node an Identifier, Assign or Feed refers to,
+    // or the Network node a Call refers to; NO_NODE if unresolved (or a
+    // linked network)
+    NodeId declarationOf(NodeId use) const { return targets[use]; }
+    
+    size_t referenceCount() const { return references; }
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    bool hasError() const { return !diagnostics.empty(); }
+};
+
+#endif // RESOLVER_H
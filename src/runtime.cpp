@@ -0,0 +1,107 @@
+#include "runtime.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+int64_t cnumToDnum(double value) {
+    if (isnan(value)) return 0;
+    if (value >= 9223372036854775807.0) return INT64_MAX;
+    if (value <= -9223372036854775808.0) return INT64_MIN;
+    return (int64_t)value;
+}
+
+string formatValue(ValueType type, Value value) {
+    char text[32];
+    switch (type) {
+        case ValueType::Dnum:
+            return string(text, to_chars(text, text + sizeof(text), value.dnum).ptr);
+        case ValueType::Cnum:
+            snprintf(text, sizeof(text), "%.15g", value.cnum);
+            return text;
+        case ValueType::Flag:
+            return value.dnum ? "true" : "false";
+        default:
+            return "";
+    }
+}
+
+// ==================== Program I/O ====================
+
+ProgramIO::ProgramIO(FILE* input, FILE* output) : in(input), out(output) {
+    block.reserve(BLOCK_SIZE);
+}
+
+ProgramIO::~ProgramIO() {
+    flush();
+}
+
+void ProgramIO::flush() {
+    if (block.empty()) return;
+    fwrite(block.data(), 1, block.size(), out);
+    fflush(out);
+    block.clear();
+}
+
+// Read the next line into line (without its line break); false at the end
+bool ProgramIO::readLine() {
+    flush();
+    line.clear();
+    
+    int c = fgetc(in);
+    if (c == EOF) return false;
+    while (c != EOF && c != '\n') {
+        line += (char)c;
+        c = fgetc(in);
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+int64_t ProgramIO::feedDnum() {
+    if (!readLine()) return 0;
+    return strtoll(line.c_str(), nullptr, 10);
+}
+
+double ProgramIO::feedCnum() {
+    if (!readLine()) return 0;
+    return strtod(line.c_str(), nullptr);
+}
+
+bool ProgramIO::feedFlag() {
+    if (!readLine()) return false;
+    return line == "true" || line == "1";
+}
+
+string ProgramIO::feedText() {
+    if (!readLine()) return "";
+    return line;
+}
+
+void ProgramIO::endValue() {
+    block += '\n';
+    if (block.size() >= BLOCK_SIZE) flush();
+}
+
+void ProgramIO::forwardDnum(int64_t value) {
+    char text[24];
+    block.append(text, to_chars(text, text + sizeof(text), value).ptr);
+    endValue();
+}
+
+void ProgramIO::forwardCnum(double value) {
+    char text[32];
+    block.append(text, snprintf(text, sizeof(text), "%.15g", value));
+    endValue();
+}
+
+void ProgramIO::forwardFlag(bool value) {
+    block += value ? "true" : "false";
+    endValue();
+}
+
+void ProgramIO::forwardText(const string& value) {
+    block += value;
+    endValue();
+}
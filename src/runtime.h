@@ -0,0 +1,76 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "type_checker.h"
+
+using namespace std;
+
+// A dnum, cnum or flag (0 or 1) at run time; text is kept apart
+union Value {
+    int64_t dnum;
+    double cnum;
+};
+
+// ==================== Arithmetic ====================
+// What the execution engines compute where C leaves the result undefined:
+// dnum arithmetic wraps around, shift counts are taken modulo 64 and a
+// cnum too large for a dnum saturates. Division by zero is checked by the
+// caller.
+
+inline int64_t wrapAdd(int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); }
+inline int64_t wrapSub(int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); }
+inline int64_t wrapMul(int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); }
+inline int64_t wrapNeg(int64_t a) { return (int64_t)(0 - (uint64_t)a); }
+inline int64_t wrapDiv(int64_t a, int64_t b) { return b == -1 ? wrapNeg(a) : a / b; }
+inline int64_t wrapMod(int64_t a, int64_t b) { return b == -1 ? 0 : a % b; }
+inline int64_t shiftLeft(int64_t a, int64_t count) { return (int64_t)((uint64_t)a << (count & 63)); }
+inline int64_t shiftRight(int64_t a, int64_t count) { return a >> (count & 63); }
+int64_t cnumToDnum(double value);
+
+// ==================== Program I/O ====================
+
+// ProgramIO - where feed reads from and forward writes to
+// Every feed reads one line of input, parsed by the type of the variable
+// (a flag is true for "true" or "1"); at the end of the input the variable
+// gets zero, false or "". Every forward writes one value and a newline.
+// Output is gathered in a block and written with one fwrite when the block
+// fills, before a feed (so prompts appear) and at the end of the run.
+class ProgramIO {
+private:
+    static const size_t BLOCK_SIZE = 1 << 16;
+    
+    FILE* in;               // Not owned
+    FILE* out;              // Not owned
+    string block;           // Output not yet written
+    string line;            // Last line read
+    
+    bool readLine();
+    void endValue();
+    
+public:
+    ProgramIO(FILE* in, FILE* out);
+    ~ProgramIO();           // Flushes what is left
+    
+    ProgramIO(const ProgramIO&) = delete;
+    ProgramIO& operator=(const ProgramIO&) = delete;
+    
+    int64_t feedDnum();
+    double feedCnum();
+    bool feedFlag();
+    string feedText();
+    
+    void forwardDnum(int64_t value);
+    void forwardCnum(double value);
+    void forwardFlag(bool value);
+    void forwardText(const string& value);
+    
+    void flush();
+};
+
+// Text of a value as forward writes it (without the newline)
+string formatValue(ValueType type, Value value);
+
+#endif // RUNTIME_H
@@ -0,0 +1,242 @@
+#include "scan_kernels.h"
+#include <cstring>
+#include <atomic>
+
+// SSE2 is baseline on x86-64; AVX2 code is compiled per function with a
+// target attribute, so the rest of the build stays baseline
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NETC_X86 1
+#define NETC_HAVE_AVX2 1
+#define NETC_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// ==================== Scalar Kernels ====================
+
+static inline bool isBlank(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool isIdentifierByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || 
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+static inline bool isDigitByte(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+static size_t scalarNonBlank(const char* data, size_t pos, size_t end) {
+    while (pos < end && isBlank(data[pos])) pos++;
+    return pos;
+}
+
+static size_t scalarNewline(const char* data, size_t pos, size_t end) {
+    const void* hit = memchr(data + pos, '\n', end - pos);
+    return hit ? static_cast<const char*>(hit) - data : end;
+}
+
+static size_t scalarQuoteOrNewline(const char* data, size_t pos, size_t end) {
+    while (pos < end && data[pos] != '"' && data[pos] != '\n') pos++;
+    return pos;
+}
+
+static size_t scalarIdentifierEnd(const char* data, size_t pos, size_t end) {
+    while (pos < end && isIdentifierByte(data[pos])) pos++;
+    return pos;
+}
+
+static size_t scalarDigitEnd(const char* data, size_t pos, size_t end) {
+    while (pos < end && isDigitByte(data[pos])) pos++;
+    return pos;
+}
+
+static const ScanKernelTable scalarTable = {
+    ScanKernel::Scalar, scalarNonBlank, scalarNewline, scalarQuoteOrNewline,
+    scalarIdentifierEnd, scalarDigitEnd
+};
+
+#ifdef NETC_X86
+
+// ==================== SSE2 Kernels ====================
+
+// Bytes in [lo, hi] as a compare mask (SSE2 only has signed compares)
+static inline __m128i inRange16(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(-128 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + (hi - lo + 1))));
+}
+
+// ' ' or one of '\t' '\n' '\r' (0x09, 0x0A, 0x0D)
+static inline __m128i blankMask16(__m128i v) {
+    __m128i control = _mm_or_si128(inRange16(v, '\t', '\n'), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    return _mm_or_si128(control, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+static inline __m128i identifierMask16(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(_mm_or_si128(inRange16(lower, 'a', 'z'), inRange16(v, '0', '9')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+// Scan 16-byte blocks until `stop` has a bit set; scalar loop for the tail
+#define NETC_SSE2_SCAN(STOP_BITS, SCALAR)                                   \
+    while (pos + 16 <= end) {                                               \
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + pos));          \
+        unsigned bits = (STOP_BITS);                                        \
+        if (bits) return pos + __builtin_ctz(bits);                         \
+        pos += 16;                                                          \
+    }                                                                       \
+    return SCALAR(data, pos, end);
+
+static size_t sse2NonBlank(const char* data, size_t pos, size_t end) {
+    NETC_SSE2_SCAN(~_mm_movemask_epi8(blankMask16(v)) & 0xFFFF, scalarNonBlank)
+}
+
+static size_t sse2Newline(const char* data, size_t pos, size_t end) {
+    NETC_SSE2_SCAN(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))), scalarNewline)
+}
+
+static size_t sse2QuoteOrNewline(const char* data, size_t pos, size_t end) {
+    NETC_SSE2_SCAN(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')))),
+                   scalarQuoteOrNewline)
+}
+
+static size_t sse2IdentifierEnd(const char* data, size_t pos, size_t end) {
+    NETC_SSE2_SCAN(~_mm_movemask_epi8(identifierMask16(v)) & 0xFFFF, scalarIdentifierEnd)
+}
+
+static size_t sse2DigitEnd(const char* data, size_t pos, size_t end) {
+    NETC_SSE2_SCAN(~_mm_movemask_epi8(inRange16(v, '0', '9')) & 0xFFFF, scalarDigitEnd)
+}
+
+static const ScanKernelTable sse2Table = {
+    ScanKernel::SSE2, sse2NonBlank, sse2Newline, sse2QuoteOrNewline,
+    sse2IdentifierEnd, sse2DigitEnd
+};
+
+#endif // NETC_X86
+
+#ifdef NETC_HAVE_AVX2
+
+// ==================== AVX2 Kernels ====================
+
+NETC_TARGET_AVX2 static inline __m256i inRange32(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(-128 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + (hi - lo + 1))), shifted);
+}
+
+NETC_TARGET_AVX2 static inline __m256i blankMask32(__m256i v) {
+    __m256i control = _mm256_or_si256(inRange32(v, '\t', '\n'),
+                                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    return _mm256_or_si256(control, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+}
+
+NETC_TARGET_AVX2 static inline __m256i identifierMask32(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(_mm256_or_si256(inRange32(lower, 'a', 'z'), inRange32(v, '0', '9')),
+                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+}
+
+// Scan 32-byte blocks, then hand the tail to the SSE2 kernel
+#define NETC_AVX2_SCAN(STOP_BITS, SSE2)                                     \
+    while (pos + 32 <= end) {                                               \
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + pos));       \
+        unsigned bits = (STOP_BITS);                                        \
+        if (bits) return pos + __builtin_ctz(bits);                         \
+        pos += 32;                                                          \
+    }                                                                       \
+    return SSE2(data, pos, end);
+
+NETC_TARGET_AVX2 static size_t avx2NonBlank(const char* data, size_t pos, size_t end) {
+    NETC_AVX2_SCAN(~(unsigned)_mm256_movemask_epi8(blankMask32(v)), sse2NonBlank)
+}
+
+NETC_TARGET_AVX2 static size_t avx2Newline(const char* data, size_t pos, size_t end) {
+    NETC_AVX2_SCAN((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+                   sse2Newline)
+}
+
+NETC_TARGET_AVX2 static size_t avx2QuoteOrNewline(const char* data, size_t pos, size_t end) {
+    NETC_AVX2_SCAN((unsigned)_mm256_movemask_epi8(
+                       _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                       _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')))),
+                   sse2QuoteOrNewline)
+}
+
+NETC_TARGET_AVX2 static size_t avx2IdentifierEnd(const char* data, size_t pos, size_t end) {
+    NETC_AVX2_SCAN(~(unsigned)_mm256_movemask_epi8(identifierMask32(v)), sse2IdentifierEnd)
+}
+
+NETC_TARGET_AVX2 static size_t avx2DigitEnd(const char* data, size_t pos, size_t end) {
+    NETC_AVX2_SCAN(~(unsigned)_mm256_movemask_epi8(inRange32(v, '0', '9')), sse2DigitEnd)
+}
+
+static const ScanKernelTable avx2Table = {
+    ScanKernel::AVX2, avx2NonBlank, avx2Newline, avx2QuoteOrNewline,
+    avx2IdentifierEnd, avx2DigitEnd
+};
+
+#endif // NETC_HAVE_AVX2
+
+// ==================== Dispatch ====================
+
+// Table for a kernel, or nullptr if it cannot run here
+static const ScanKernelTable* kernelTable(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::Scalar:
+            return &scalarTable;
+        case ScanKernel::SSE2:
+#ifdef NETC_X86
+            return &sse2Table;
+#else
+            return nullptr;
+#endif
+        case ScanKernel::AVX2:
+#ifdef NETC_HAVE_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return &avx2Table;
+#endif
+            return nullptr;
+        case ScanKernel::Auto:
+            if (const ScanKernelTable* table = kernelTable(ScanKernel::AVX2)) return table;
+            if (const ScanKernelTable* table = kernelTable(ScanKernel::SSE2)) return table;
+            return &scalarTable;
+    }
+    return nullptr;
+}
+
+// Read by every scanner, possibly on several threads at once
+static atomic<const ScanKernelTable*> activeTable(kernelTable(ScanKernel::Auto));
+
+bool setScanKernel(ScanKernel kernel) {
+    const ScanKernelTable* table = kernelTable(kernel);
+    if (!table) return false;
+    activeTable.store(table, memory_order_relaxed);
+    return true;
+}
+
+const ScanKernelTable& scanKernels() {
+    return *activeTable.load(memory_order_relaxed);
+}
+
+bool parseScanKernel(const char* name, ScanKernel& kernel) {
+    if (strcmp(name, "auto") == 0) kernel = ScanKernel::Auto;
+    else if (strcmp(name, "scalar") == 0) kernel = ScanKernel::Scalar;
+    else if (strcmp(name, "sse2") == 0) kernel = ScanKernel::SSE2;
+    else if (strcmp(name, "avx2") == 0) kernel = ScanKernel::AVX2;
+    else return false;
+    return true;
+}
+
+const char* scanKernelName(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::Auto: return "auto";
+        case ScanKernel::Scalar: return "scalar";
+        case ScanKernel::SSE2: return "sse2";
+        case ScanKernel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,43 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+
+using namespace std;
+
+// Byte-run search kernels used by the Scanner to skip over whitespace,
+// comments, string bodies, identifiers and digit runs in bulk.
+// Every kernel takes the source text and a [pos, end) range and returns
+// the offset of the first byte that ends the run, or end if none does.
+
+// Kernel implementations that can be selected at runtime
+enum class ScanKernel {
+    Auto,       // Best kernel supported by this CPU
+    Scalar,     // Portable byte-at-a-time loops
+    SSE2,       // 16 bytes per step
+    AVX2        // 32 bytes per step
+};
+
+// Function table for one kernel implementation
+struct ScanKernelTable {
+    ScanKernel kind;
+    size_t (*findNonBlank)(const char* data, size_t pos, size_t end);      // not ' ', '\t', '\r', '\n'
+    size_t (*findNewline)(const char* data, size_t pos, size_t end);       // '\n'
+    size_t (*findQuoteOrNewline)(const char* data, size_t pos, size_t end); // '"' or '\n'
+    size_t (*findIdentifierEnd)(const char* data, size_t pos, size_t end); // not [A-Za-z0-9_]
+    size_t (*findDigitEnd)(const char* data, size_t pos, size_t end);      // not [0-9]
+};
+
+// Select the kernel used by all scanners (call before starting threads
+// that scan, so they all agree); returns false (and keeps the
+// current selection) if this CPU or build does not support it
+bool setScanKernel(ScanKernel kernel);
+
+// Currently selected kernel table
+const ScanKernelTable& scanKernels();
+
+// Parse/print kernel names ("auto", "scalar", "sse2", "avx2")
+bool parseScanKernel(const char* name, ScanKernel& kernel);
+const char* scanKernelName(ScanKernel kernel);
+
+#endif // SCAN_KERNELS_H
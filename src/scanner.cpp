@@ -1,29 +1,88 @@
 #include "scanner.h"
+#include "char_class.h"
+#include "scan_kernels.h"
+#include "task_pool.h"
+#include "token_writer.h"
+#include <algorithm>
 #include <iostream>
-#include <cctype>
+#include <memory>
 
 using namespace std;
 
-// Constructor - initializes scanner with source code
-Scanner::Scanner(const string& src) : source(src), start(0), current(0), line(1), column(1) {
-    // Initialize keywords map
-    keywords["feed"] = FEED;
-    keywords["forward"] = FORWARD;
-    keywords["iterate"] = ITERATE;
-    keywords["until"] = UNTIL;
-    keywords["network"] = NETWORK;
-    keywords["init"] = INIT;
-    keywords["if"] = IF;
-    keywords["else"] = ELSE;
-    keywords["yield"] = YIELD;
-    keywords["link"] = LINK;
-    keywords["text"] = TEXT;
-    keywords["dnum"] = DNUM;
-    keywords["cnum"] = CNUM;
-    keywords["flag"] = FLAG;
-    keywords["true"] = BOOLEAN_LITERAL;
-    keywords["false"] = BOOLEAN_LITERAL;
-    keywords["+"] = PLUS;
+// Classify an identifier as a keyword, or IDENTIFIER if it is not one.
+// Dispatches on length and first character, then compares the candidate,
+// so it needs no table to build and allocates nothing.
+static constexpr TokenType classifyKeyword(string_view text) {
+    switch (text.size()) {
+        case 2:
+            if (text == "if") return IF;
+            break;
+        case 4:
+            switch (text[0]) {
+                case 'c': if (text == "cnum") return CNUM; break;
+                case 'd': if (text == "dnum") return DNUM; break;
+                case 'e': if (text == "else") return ELSE; break;
+                case 'f':
+                    if (text == "feed") return FEED;
+                    if (text == "flag") return FLAG;
+                    break;
+                case 'i': if (text == "init") return INIT; break;
+                case 'l': if (text == "link") return LINK; break;
+                case 't':
+                    if (text == "text") return TEXT;
+                    if (text == "true") return BOOLEAN_LITERAL;
+                    break;
+            }
+            break;
+        case 5:
+            switch (text[0]) {
+                case 'f': if (text == "false") return BOOLEAN_LITERAL; break;
+                case 'u': if (text == "until") return UNTIL; break;
+                case 'y': if (text == "yield") return YIELD; break;
+            }
+            break;
+        case 7:
+            switch (text[0]) {
+                case 'f': if (text == "forward") return FORWARD; break;
+                case 'i': if (text == "iterate") return ITERATE; break;
+                case 'n': if (text == "network") return NETWORK; break;
+            }
+            break;
+    }
+    return IDENTIFIER;
+}
+
+static_assert(classifyKeyword("network") == NETWORK, "keyword table");
+static_assert(classifyKeyword("false") == BOOLEAN_LITERAL, "keyword table");
+static_assert(classifyKeyword("flags") == IDENTIFIER, "keyword table");
+static_assert(classifyKeyword("+") == IDENTIFIER, "keyword table");
+
+// Constructor - initializes scanner with its own copy of the source code
+Scanner::Scanner(const string& src) 
+    : storage(src), source(storage), start(0), current(0), mode(ScanMode::Switch), 
+      pending(UNKNOWN, "", 0), hasPending(false), produced(0), reachedEnd(false), deferErrors(false), unterminated(false) {
+    lines.reset(source);
+}
+
+// Constructor - scans a mapped or buffered file without copying it
+Scanner::Scanner(const SourceFile& file) 
+    : source(file.text()), start(0), current(0), mode(ScanMode::Switch), 
+      pending(UNKNOWN, "", 0), hasPending(false), produced(0), reachedEnd(false), deferErrors(false), unterminated(false) {
+    lines.reset(source);
+}
+
+// Constructor - one chunk of a parallel scan; errors are only recorded,
+// since their positions depend on strings in earlier chunks
+Scanner::Scanner(string_view text, ScanMode scanMode) 
+    : source(text), start(0), current(0), mode(scanMode), 
+      pending(UNKNOWN, "", 0), hasPending(false), produced(0), reachedEnd(false), deferErrors(true), unterminated(false) {
+    lines.reset(source);
+    buffer.reset(source);
+}
+
+// Select the switch-based or table-driven token recognizer
+void Scanner::setMode(ScanMode m) {
+    mode = m;
 }
 
 // Check if we've reached the end of source code
@@ -33,7 +92,6 @@ bool Scanner::isAtEnd() {
 
 // Get current character and move forward
 char Scanner::advance() {
-    column++;
     return source[current++];
 }
 
@@ -49,19 +107,24 @@ char Scanner::peekNext() {
     return source[current + 1];
 }
 
+// Consume everything up to (not including) position end
+void Scanner::skipTo(size_t end) {
+    current = end;
+}
+
 // Check if current character matches expected, consume if true
 bool Scanner::match(char expected) {
     if (isAtEnd()) return false;
     if (source[current] != expected) return false;
     current++;
-    column++;
     return true;
 }
 
-// Add a token to the token list
+// Emit a token for the lexeme between start and current
 void Scanner::addToken(TokenType type) {
-    string text = source.substr(start, current - start);
-    tokens.push_back(Token(type, text, line, column - text.length()));
+    string_view text = source.substr(start, current - start);
+    pending = Token(type, text, start);
+    hasPending = true;
 }
 
 // Main token scanning method
@@ -130,7 +193,7 @@ void Scanner::scanToken() {
         
         // Comments - scan to end of line
         case '#':
-            while (peek() != '\n' && !isAtEnd()) advance();
+            skipTo(scanKernels().findNewline(source.data(), current, source.length()));
             addToken(COMMENT);
             break;
         
@@ -139,44 +202,100 @@ void Scanner::scanToken() {
             scanString();
             break;
         
-        // Whitespace - ignore but track newlines for line numbers
+        // Whitespace - ignore (newlines are in the line index already)
         case ' ':
         case '\r':
         case '\t':
-            break;
         case '\n':
-            line++;
-            column = 1;
+            skipTo(scanKernels().findNonBlank(source.data(), current, source.length()));
             break;
         
         // Numbers, identifiers, or unknown
         default:
-            if (isdigit(c)) {
+            if (isDigitChar(c)) {
                 scanNumber();
-            } else if (isalpha(c) || c == '_') {
+            } else if (isAlphaChar(c)) {
                 scanIdentifier();
             } else {
-                cout << "Error: Unknown character '" << c << "' at line " << line 
-                     << ", column " << column << endl;
-                addToken(UNKNOWN);
+                unknownCharacter(c);
             }
             break;
     }
 }
 
+// Table-driven token scanning
+// One class lookup replaces the character switch; operators are recognized
+// by running the operator DFA until it cannot be extended.
+void Scanner::scanTokenTable() {
+    char c = advance();
+    uint8_t cls = charClass[c];
+    
+    if (cls >= CC_FIRST_OPERATOR) {
+        int state = operatorDfa.next[0][cls];
+        while (!isAtEnd()) {
+            int next = operatorDfa.next[state][charClass[source[current]]];
+            if (next == 0) break;
+            state = next;
+            advance();
+        }
+        addToken(operatorDfa.accept[state]);
+        return;
+    }
+    
+    switch (cls) {
+        case CC_BLANK:
+        case CC_NEWLINE:
+            skipTo(scanKernels().findNonBlank(source.data(), current, source.length()));
+            break;
+        case CC_ALPHA:
+            scanIdentifier();
+            break;
+        case CC_DIGIT:
+            scanNumber();
+            break;
+        case CC_QUOTE:
+            scanString();
+            break;
+        case CC_HASH:
+            skipTo(scanKernels().findNewline(source.data(), current, source.length()));
+            addToken(COMMENT);
+            break;
+        default:
+            unknownCharacter(c);
+            break;
+    }
+}
+
+// Report a character that cannot start any token
+void Scanner::unknownCharacter(char c) {
+    if (deferErrors) {
+        unknownSites.push_back(start);
+        addToken(UNKNOWN);
+        return;
+    }
+    
+    // Reported column is the one just past the character
+    SourcePosition position = lines.position(start, 1);
+    diagnostics.report(DiagnosticPhase::Scanner, position.line, position.column + 1,
+                       string("Unknown character '") + c + "'");
+    addToken(UNKNOWN);
+}
+
 // Scan a string literal (between double quotes)
 void Scanner::scanString() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') {
-            line++;
-            column = 1;
-        }
+    const ScanKernelTable& kernels = scanKernels();
+    
+    while (true) {
+        skipTo(kernels.findQuoteOrNewline(source.data(), current, source.length()));
+        if (peek() != '\n') break;
+        lines.addStringNewline(current);
         advance();
     }
     
     // Unterminated string error
     if (isAtEnd()) {
-        cout << "Error: Unterminated string at line " << line << endl;
+        if (deferErrors) unterminated = true;
+        else diagnostics.report(DiagnosticPhase::Scanner, lines.lineOf(current), 0, "Unterminated string");
         return;
     }
     
@@ -186,13 +305,15 @@ void Scanner::scanString() {
 
 // Scan a numeric literal (integer or floating point)
 void Scanner::scanNumber() {
+    const ScanKernelTable& kernels = scanKernels();
+    
     // Consume all digits
-    while (isdigit(peek())) advance();
+    skipTo(kernels.findDigitEnd(source.data(), current, source.length()));
     
     // Check for decimal point followed by digits (floating point)
-    if (peek() == '.' && isdigit(peekNext())) {
+    if (peek() == '.' && isDigitChar(peekNext())) {
         advance(); // Consume '.'
-        while (isdigit(peek())) advance();
+        skipTo(kernels.findDigitEnd(source.data(), current, source.length()));
         addToken(FLOAT_LITERAL);
     } else {
         addToken(INTEGER_LITERAL);
@@ -202,49 +323,256 @@ void Scanner::scanNumber() {
 // Scan an identifier or keyword
 void Scanner::scanIdentifier() {
     // Consume alphanumeric characters and underscores
-    while (isalnum(peek()) || peek() == '_') advance();
+    skipTo(scanKernels().findIdentifierEnd(source.data(), current, source.length()));
     
     // Check if it's a keyword or just an identifier
-    string text = source.substr(start, current - start);
-    TokenType type = keywords.count(text) ? keywords[text] : IDENTIFIER;
+    string_view text = source.substr(start, current - start);
+    TokenType type = classifyKeyword(text);
     addToken(type);
+    
+    // Chunks of a parallel scan are interned after joining, so ids follow
+    // first appearance in the whole source
+    if (type == IDENTIFIER && !deferErrors) pending.symbol = interner.intern(text);
 }
 
-// Main method - scan all tokens from source
-vector<Token> Scanner::scanTokens() {
+// Scan forward until the next token is produced
+Token Scanner::nextToken() {
+    hasPending = false;
+    
     while (!isAtEnd()) {
         start = current;
-        scanToken();
+        if (mode == ScanMode::Table) scanTokenTable();
+        else scanToken();
+        if (hasPending) {
+            produced++;
+            return pending;
+        }
     }
     
-    // Add end-of-file token
-    tokens.push_back(Token(END_OF_FILE, "", line, column));
+    // End-of-file token
+    if (!reachedEnd) produced++;
+    reachedEnd = true;
+    return Token(END_OF_FILE, source.substr(current, 0), current);
+}
+
+// Main method - scan all tokens from source
+const vector<Token>& Scanner::scanTokens() {
+    while (true) {
+        tokens.push_back(nextToken());
+        if (tokens.back().type == END_OF_FILE) break;
+    }
     return tokens;
 }
 
+// Scan all tokens into the struct-of-arrays buffer
+const TokenBuffer& Scanner::scanBuffer() {
+    buffer.reset(source);
+    buffer.reserve(source.length() / 8 + 1);
+    
+    while (true) {
+        Token token = nextToken();
+        buffer.push(token.type, token.offset, token.lexeme.size(), token.symbol);
+        if (token.type == END_OF_FILE) break;
+    }
+    
+    buffer.lines = lines;
+    return buffer;
+}
+
+// Scan one range of a parallel scan (see scanRange in scanner.h)
+size_t Scanner::scanRange(size_t from, size_t end, const TokenBuffer* along, 
+                          size_t alongFrom, int64_t shift) {
+    size_t next = alongFrom;
+    current = from;
+    
+    while (!isAtEnd() && current < end) {
+        // Both scans start a token here, so they agree from now on
+        if (along) {
+            while (next < along->size() && along->offset(next) + shift < (int64_t)current) next++;
+            if (next < along->size() && along->offset(next) + shift == (int64_t)current) return next;
+        }
+        
+        start = current;
+        hasPending = false;
+        if (mode == ScanMode::Table) scanTokenTable();
+        else scanToken();
+        if (hasPending) buffer.push(pending.type, pending.offset, pending.lexeme.size(), pending.symbol);
+    }
+    return along ? along->size() : 0;
+}
+
+// Scan chunks on a thread pool, repair the cuts, then join the arrays
+const TokenBuffer& Scanner::scanBufferParallel(unsigned jobs, size_t minChunk) {
+    const ScanKernelTable& kernels = scanKernels();
+    size_t length = source.length();
+    TaskPool pool(jobs);
+    
+    // A few chunks per thread, so stealing can even out uneven chunks
+    size_t target = min((size_t)pool.workerCount() * 4, length / max(minChunk, (size_t)1));
+    if (pool.workerCount() < 2 || target < 2) return scanBuffer();
+    
+    // Cut just after a newline: no token but a string or a blank run
+    // continues past one, so a chunk starts either outside any token or
+    // inside one of those two
+    vector<size_t> cuts(1, 0);
+    for (size_t i = 1; i < target; i++) {
+        size_t newline = kernels.findNewline(source.data(), length * i / target, length);
+        if (newline + 1 >= length) break;
+        if (newline + 1 > cuts.back()) cuts.push_back(newline + 1);
+    }
+    cuts.push_back(length);
+    size_t count = cuts.size() - 1;
+    
+    // Speculative pass: scan every chunk from its first byte
+    vector<unique_ptr<Scanner>> chunks(count);
+    pool.run(count, [&](size_t i) {
+        chunks[i].reset(new Scanner(source, mode));
+        chunks[i]->scanRange(cuts[i], cuts[i + 1], nullptr);
+    });
+    
+    // Fix-up pass, in order. position is where the real scan starts its
+    // next token. Where that is past the cut, rescan the chunk from there
+    // until the rescan reaches a token start of the speculative scan; the
+    // chunk's tokens from that one on are kept. taken[i] is the offset
+    // from which chunk i's results are kept (length if none are).
+    vector<unique_ptr<Scanner>> fixups(count);
+    vector<size_t> joins(count);
+    vector<size_t> taken(count, length);
+    size_t position = 0;
+    bool endsInString = false;
+    for (size_t i = 0; i < count; i++) {
+        Scanner& chunk = *chunks[i];
+        joins[i] = chunk.buffer.size();
+        
+        // Swallowed whole by a token from an earlier chunk
+        if (position >= cuts[i + 1]) continue;
+        
+        if (position > cuts[i]) {
+            fixups[i].reset(new Scanner(source, mode));
+            Scanner& fixup = *fixups[i];
+            joins[i] = fixup.scanRange(position, cuts[i + 1], &chunk.buffer);
+            if (joins[i] == chunk.buffer.size()) {
+                position = fixup.current;
+                endsInString = fixup.unterminated;
+                continue;
+            }
+            taken[i] = chunk.buffer.offset(joins[i]);
+        } else {
+            joins[i] = 0;
+            taken[i] = cuts[i];
+        }
+        position = chunk.current;
+        endsInString = chunk.unterminated;
+    }
+    
+    // Join the token arrays; each chunk copies its own part
+    vector<size_t> firsts(count + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+        size_t fixed = fixups[i] ? fixups[i]->buffer.size() : 0;
+        firsts[i + 1] = firsts[i] + fixed + chunks[i]->buffer.size() - joins[i];
+    }
+    size_t total = firsts[count];
+    
+    buffer.reset(source);
+    buffer.types.resize(total + 1);
+    buffer.offsets.resize(total + 1);
+    buffer.lengths.resize(total + 1);
+    
+    pool.run(count, [&](size_t i) {
+        size_t at = firsts[i];
+        auto copyTokens = [&](const TokenBuffer& from, size_t first) {
+            size_t n = from.size() - first;
+            copy_n(from.types.begin() + first, n, buffer.types.begin() + at);
+            copy_n(from.offsets.begin() + first, n, buffer.offsets.begin() + at);
+            copy_n(from.lengths.begin() + first, n, buffer.lengths.begin() + at);
+            at += n;
+        };
+        if (fixups[i]) copyTokens(fixups[i]->buffer, 0);
+        copyTokens(chunks[i]->buffer, joins[i]);
+    });
+    
+    buffer.types[total] = END_OF_FILE;
+    buffer.offsets[total] = length;
+    buffer.lengths[total] = 0;
+    buffer.typeView = buffer.types.data();
+    buffer.offsetView = buffer.offsets.data();
+    buffer.lengthView = buffer.lengths.data();
+    buffer.count = total + 1;
+    internIdentifiers();
+    
+    // Gather the recorded string newlines and errors in source order, then
+    // report them exactly as a sequential scan would
+    vector<uint32_t> newlines;
+    vector<uint32_t> unknowns;
+    auto keep = [](const vector<uint32_t>& sites, size_t from, vector<uint32_t>& into) {
+        into.insert(into.end(), lower_bound(sites.begin(), sites.end(), (uint32_t)from), sites.end());
+    };
+    for (size_t i = 0; i < count; i++) {
+        if (fixups[i]) {
+            keep(fixups[i]->lines.stringNewlineOffsets(), 0, newlines);
+            keep(fixups[i]->unknownSites, 0, unknowns);
+        }
+        keep(chunks[i]->lines.stringNewlineOffsets(), taken[i], newlines);
+        keep(chunks[i]->unknownSites, taken[i], unknowns);
+    }
+    
+    lines.reset(source);
+    for (uint32_t newline : newlines) lines.addStringNewline(newline);
+    for (uint32_t site : unknowns) {
+        SourcePosition at = lines.position(site, 1);
+        diagnostics.report(DiagnosticPhase::Scanner, at.line, at.column + 1,
+                           string("Unknown character '") + source[site] + "'");
+    }
+    if (endsInString) {
+        diagnostics.report(DiagnosticPhase::Scanner, lines.lineOf(length), 0, "Unterminated string");
+    }
+    
+    current = length;
+    buffer.lines = lines;
+    return buffer;
+}
+
+// Intern identifiers in one pass over the joined or loaded token arrays
+void Scanner::internIdentifiers() {
+    buffer.symbols.assign(buffer.size(), NO_SYMBOL);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        if (buffer.type(i) == IDENTIFIER) buffer.symbols[i] = interner.intern(buffer.lexeme(i));
+    }
+}
+
+bool Scanner::loadCache(TokenCache& cache, const string& path) {
+    if (!cache.load(path, source, buffer)) return false;
+    lines = buffer.lines;
+    internIdentifiers();
+    return true;
+}
+
 // Print all tokens in a formatted table
 void Scanner::printTokens() {
     cout << "\n====================== TOKEN LIST ======================\n";
     cout << "Line\tCol\tType\t\t\tLexeme\n";
     cout << "----\t---\t----\t\t\t------\n";
     
-    for (const auto& token : tokens) {
-        // Skip comments in output (optional - remove if you want to see them)
-        if (token.type == COMMENT) continue;
-        
-        cout << token.line << "\t" << token.column << "\t" 
-             << tokenTypeToString(token.type);
-        
-        // Add extra tab for alignment if type name is short
-        if (tokenTypeToString(token.type).length() < 16) cout << "\t";
-        if (tokenTypeToString(token.type).length() < 8) cout << "\t";
-        
-        cout << token.lexeme << "\n";
+    // Tokens come from scanBuffer() if it was used, else from scanTokens()
+    size_t count = buffer.size() > 0 ? buffer.size() : tokens.size();
+    
+    {
+        TokenWriter writer(stdout, TokenTableStyle::Console);
+        size_t line = 0;
+        for (size_t i = 0; i < count; i++) {
+            Token token = buffer.size() > 0 ? buffer.token(i) : tokens[i];
+            
+            // Skip comments in output (optional - remove if you want to see them)
+            if (token.type == COMMENT) continue;
+            
+            SourcePosition position = lines.positionFrom(line, token.offset, token.lexeme.size());
+            writer.writeToken(position, token.type, token.lexeme);
+        }
     }
     cout << "========================================================\n";
 }
 
 // Getter for tokens
-vector<Token> Scanner::getTokens() const {
+const vector<Token>& Scanner::getTokens() const {
     return tokens;
 }
\ No newline at end of file
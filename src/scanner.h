@@ -2,24 +2,67 @@
 #define SCANNER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include "token.h"
+#include "token_buffer.h"
+#include "line_index.h"
+#include "source_file.h"
+#include "diagnostics.h"
+#include "token_cache.h"
+#include "interner.h"
 
 using namespace std;
 
+// Token recognition strategy (both produce the same token stream)
+enum class ScanMode {
+    Switch,     // Hand-written switch on the current character
+    Table       // Character-class table plus operator DFA
+};
+
 // Scanner class - performs lexical analysis on NetC source code
+// Tokens hold views into the source buffer, so the scanner (and the
+// SourceFile it was built from, if any) must outlive every token.
+// Line and column are not tracked while scanning; they are resolved from
+// the line index when a position is needed.
 class Scanner {
 private:
-    string source;              // The source code to scan
-    vector<Token> tokens;       // List of tokens found
-    int start;                  // Start position of current lexeme
-    int current;                // Current position in source
-    int line;                   // Current line number
-    int column;                 // Current column number
+    string storage;             // Owned copy when built from a string
+    string_view source;         // The source code to scan
+    vector<Token> tokens;       // List of tokens found (scanTokens)
+    TokenBuffer buffer;         // Struct-of-arrays tokens (scanBuffer)
+    LineIndex lines;            // Start offset of every line
+    Diagnostics diagnostics;    // Lexical errors, in source order
+    size_t start;               // Start position of current lexeme
+    size_t current;             // Current position in source
+    ScanMode mode;              // Token recognition strategy
+    Token pending;              // Token produced by the last scanToken()
+    bool hasPending;            // True if scanToken() produced a token
+    size_t produced;            // Tokens nextToken() has returned (END_OF_FILE once)
+    bool reachedEnd;            // nextToken() has returned END_OF_FILE
+    bool deferErrors;           // Record error sites instead of reporting them
+    vector<uint32_t> unknownSites; // Offsets of unknown characters (deferred)
+    bool unterminated;          // Source ended inside a string (deferred)
+    Interner interner;          // Identifier names of this source (chunk
+                                // scanners leave identifiers uninterned)
+    
+    // Chunk scanner for scanBufferParallel: views the source, defers errors
+    Scanner(string_view source, ScanMode mode);
+    
+    // Scan tokens into buffer from offset from until a token would start
+    // at or after end. Given the tokens of an earlier scan (along), stop as
+    // soon as a token would start where one of its tokens starts and return
+    // that token's index; otherwise return along's size. Only along's
+    // tokens from alongFrom on are considered, with shift added to their
+    // offsets (for a scan of the text before an edit).
+    size_t scanRange(size_t from, size_t end, const TokenBuffer* along, 
+                     size_t alongFrom = 0, int64_t shift = 0);
     
-    // Map of keywords to their token types
-    map<string, TokenType> keywords;
+    friend class EditSession;   // Rescans edited text with scanRange
+    
+    // Set the symbol of every IDENTIFIER in buffer, in token order (for
+    // tokens that were not scanned one at a time)
+    void internIdentifiers();
     
     // Helper methods for scanning
     bool isAtEnd();                    // Check if reached end of source
@@ -27,24 +70,66 @@ private:
     char peek();                        // Look at current character without advancing
     char peekNext();                    // Look at next character without advancing
     bool match(char expected);          // Check if current char matches expected
-    void addToken(TokenType type);      // Add a token to the list
+    void skipTo(size_t end);            // Consume everything before end
+    void addToken(TokenType type);      // Emit a token for the current lexeme
     
     // Scanning methods for different token types
     void scanToken();                   // Scan a single token
+    void scanTokenTable();              // Scan a single token (table-driven)
+    void unknownCharacter(char c);      // Report and emit an UNKNOWN token
     void scanString();                  // Scan string literal
     void scanNumber();                  // Scan numeric literal
     void scanIdentifier();              // Scan identifier or keyword
     
 public:
-    // Constructor
+    // Smallest chunk scanBufferParallel hands to a thread
+    static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+    
+    // Constructors - copy a string, or scan a SourceFile in place
     Scanner(const string& source);
+    Scanner(const SourceFile& file);
+    
+    // Tokens point into this scanner's buffer, so it cannot be copied
+    Scanner(const Scanner&) = delete;
+    Scanner& operator=(const Scanner&) = delete;
+    
+    // Choose the token recognition strategy (default: Switch)
+    void setMode(ScanMode mode);
+    
+    // Main scanning method - scans the whole source into a token list
+    const vector<Token>& scanTokens();
+    
+    // Scan the whole source into struct-of-arrays storage instead of a
+    // Token list; the buffer lives as long as the scanner
+    const TokenBuffer& scanBuffer();
+    
+    // Same result as scanBuffer(), scanned on up to `jobs` threads (0 = one
+    // per hardware thread). The source is cut into chunks at line starts
+    // and each chunk is scanned as if no token spanned its start; a
+    // sequential pass then rescans wherever a string or blank run did cross
+    // a cut, until the scan falls back in step with the chunk's.
+    const TokenBuffer& scanBufferParallel(unsigned jobs, size_t minChunk = MIN_CHUNK_BYTES);
+    
+    // Take the token arrays from an .ntok cache instead of scanning. The
+    // tokens borrow the cache's mapping, so it must outlive them. Returns
+    // false (leaving the scanner untouched) if the cache does not match.
+    bool loadCache(TokenCache& cache, const string& path);
+    
+    // Streaming - scan and return the next token (END_OF_FILE at the end,
+    // repeatedly). Tokens are not added to the scanner's token list.
+    Token nextToken();
     
-    // Main scanning method
-    vector<Token> scanTokens();
+    // Tokens scanned so far, END_OF_FILE included once it is reached: once
+    // the whole source is scanned, the size of its token list or buffer
+    size_t tokenCount() const { return produced; }
     
     // Utility methods
     void printTokens();                 // Print all tokens in formatted table
-    vector<Token> getTokens() const;    // Get the token list
+    const vector<Token>& getTokens() const; // Get the token list
+    const TokenBuffer& getBuffer() const { return buffer; } // Get the token arrays
+    const LineIndex& lineIndex() const { return lines; }    // Resolve token positions
+    const Diagnostics& getDiagnostics() const { return diagnostics; } // Lexical errors
+    const Interner& getInterner() const { return interner; }  // Names of the symbol ids
 };
 
 #endif // SCANNER_H
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "source_file.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+SourceFile::SourceFile() : data(""), length(0), mapped(false) {}
+
+SourceFile::~SourceFile() {
+    release();
+}
+
+// Drop whatever the object currently holds
+void SourceFile::release() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(data), length);
+#endif
+    buffer.clear();
+    data = "";
+    length = 0;
+    mapped = false;
+}
+
+#ifdef _WIN32
+
+// Windows fallback - read through a stream into the owned buffer
+bool SourceFile::open(const string& path) {
+    release();
+    
+    if (path == "-") {
+        stringstream input;
+        input << cin.rdbuf();
+        buffer = input.str();
+    } else {
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return false;
+        stringstream input;
+        input << file.rdbuf();
+        buffer = input.str();
+    }
+    
+    data = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+bool SourceFile::readStream(int) {
+    return false;
+}
+
+#else
+
+// Read everything from a descriptor that cannot be mapped (stdin, pipes)
+bool SourceFile::readStream(int fd) {
+    char chunk[65536];
+    
+    while (true) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n == 0) break;
+        if (n < 0) return false;
+        buffer.append(chunk, n);
+    }
+    
+    data = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+// Map a regular file read-only, or fall back to reading it
+bool SourceFile::open(const string& path) {
+    release();
+    
+    if (path == "-") return readStream(STDIN_FILENO);
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    
+    // Pipes, FIFOs and character devices have no fixed size to map
+    if (!S_ISREG(info.st_mode)) {
+        bool ok = readStream(fd);
+        close(fd);
+        return ok;
+    }
+    
+    // An empty file cannot be mapped but is still valid input
+    if (info.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    
+    void* region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (region == MAP_FAILED) {
+        bool ok = readStream(fd);
+        close(fd);
+        return ok;
+    }
+    close(fd);
+    
+    // The scanner walks the file front to back
+    madvise(region, info.st_size, MADV_SEQUENTIAL);
+    
+    data = static_cast<const char*>(region);
+    length = info.st_size;
+    mapped = true;
+    return true;
+}
+
+#endif
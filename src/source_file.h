@@ -0,0 +1,38 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// SourceFile - read-only view of a NetC source file
+// Regular files are memory-mapped and scanned in place. Standard input
+// ("-"), pipes and other non-mappable inputs are read into an owned buffer.
+class SourceFile {
+private:
+    const char* data;           // Start of the source text
+    size_t length;              // Size of the source text in bytes
+    bool mapped;                // True if data points into an mmap region
+    string buffer;              // Owned copy for inputs that cannot be mapped
+    
+    bool readStream(int fd);    // Read an unmappable descriptor into buffer
+    void release();             // Unmap or drop the current contents
+    
+public:
+    SourceFile();
+    ~SourceFile();
+    
+    // The mapping is tied to this object, so it cannot be copied
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    
+    // Open a file for reading ("-" means standard input)
+    bool open(const string& path);
+    
+    // The whole source text; valid until the SourceFile is destroyed
+    string_view text() const { return string_view(data, length); }
+    bool isMapped() const { return mapped; }
+};
+
+#endif // SOURCE_FILE_H
@@ -0,0 +1,61 @@
+#include "task_pool.h"
+#include <thread>
+
+using namespace std;
+
+TaskPool::TaskPool(unsigned workers) {
+    if (workers == 0) workers = thread::hardware_concurrency();
+    if (workers == 0) workers = 1;
+    queues = vector<WorkQueue>(workers);
+}
+
+bool TaskPool::popLocal(size_t worker, size_t& task) {
+    WorkQueue& queue = queues[worker];
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+// Try every other queue once, starting after the thief's own
+bool TaskPool::steal(size_t thief, size_t& task) {
+    for (size_t i = 1; i < queues.size(); i++) {
+        WorkQueue& victim = queues[(thief + i) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void TaskPool::run(size_t count, const function<void(size_t)>& task) {
+    size_t workers = queues.size();
+    
+    // Deal out contiguous runs. Each run is stored reversed: the owner
+    // pops from the back and so works through it in order, while thieves
+    // take from the front, the tasks the owner would reach last.
+    for (size_t w = 0; w < workers; w++) {
+        size_t begin = count * w / workers;
+        size_t end = count * (w + 1) / workers;
+        for (size_t i = end; i > begin; i--) queues[w].tasks.push_back(i - 1);
+    }
+    
+    // No tasks are added once running, so a worker that finds every queue
+    // empty is done
+    auto work = [this, &task](size_t worker) {
+        size_t next;
+        while (popLocal(worker, next) || steal(worker, next)) {
+            task(next);
+        }
+    };
+    
+    vector<thread> threads;
+    for (size_t w = 1; w < workers && w < count; w++) {
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for (thread& t : threads) t.join();
+}
@@ -0,0 +1,41 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// TaskPool - runs a batch of independent tasks on a work-stealing pool
+// Tasks are numbered 0..count-1 and dealt out to per-worker queues in
+// contiguous runs. A worker takes tasks from the back of its own queue and,
+// once that is empty, steals from the front of another worker's queue, so
+// a few large inputs do not leave the other threads idle.
+class TaskPool {
+private:
+    // Task queue of one worker
+    struct WorkQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+    
+    vector<WorkQueue> queues;
+    
+    bool popLocal(size_t worker, size_t& task);
+    bool steal(size_t thief, size_t& task);
+    
+public:
+    // Use up to `workers` threads (0 = one per hardware thread)
+    explicit TaskPool(unsigned workers);
+    
+    unsigned workerCount() const { return (unsigned)queues.size(); }
+    
+    // Call task(i) for every i in [0, count) and wait for all of them. The
+    // calling thread works too. Tasks must not throw.
+    void run(size_t count, const function<void(size_t)>& task);
+};
+
+#endif // TASK_POOL_H
@@ -1,7 +1,9 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
 using namespace std;
 
@@ -44,24 +46,59 @@ enum TokenType {
     COMMENT, END_OF_FILE, UNKNOWN
 };
 
+// Dense id of an interned identifier name (see Interner); 0 is reserved
+// to mean "no symbol"
+typedef uint32_t SymbolId;
+const SymbolId NO_SYMBOL = 0;
+
 // Token structure to store information about each token
+// The lexeme is a view into the source buffer owned by the Scanner, so a
+// token is only valid while the scanner that produced it is alive.
+// Line and column are resolved from the offset through a LineIndex.
 struct Token {
     TokenType type;      // Type of the token
-    string lexeme;       // The actual text from source code
-    int line;           // Line number where token appears
-    int column;         // Column number where token starts
+    string_view lexeme;  // The actual text from source code (not owned)
+    uint32_t offset;     // Byte offset of the lexeme in the source
+    SymbolId symbol;     // Interned name of an IDENTIFIER (else NO_SYMBOL)
     
     // Constructor
-    Token(TokenType t, string lex, int l, int c);
+    Token(TokenType t, string_view lex, uint32_t off, SymbolId sym = NO_SYMBOL);
+    
+    // Copy of the lexeme, for consumers that need an owning string
+    string text() const;
+};
+
+// Token type names, indexed by TokenType
+constexpr string_view tokenTypeNameTable[] = {
+    "FEED", "FORWARD", "ITERATE", "UNTIL", "NETWORK", "INIT", "IF", "ELSE", "YIELD", "LINK",
+    "TEXT", "DNUM", "CNUM", "FLAG",
+    "PLUS", "MINUS", "MULTIPLY", "DIVIDE", "MODULO",
+    "ASSIGN", "PLUS_ASSIGN", "MINUS_ASSIGN", "MULT_ASSIGN", "DIV_ASSIGN",
+    "EQ", "NEQ", "LT", "GT", "LTE", "GTE",
+    "AND", "OR", "NOT",
+    "BITWISE_AND", "BITWISE_OR", "BITWISE_XOR", "BITWISE_NOT", "LEFT_SHIFT", "RIGHT_SHIFT",
+    "INCREMENT", "DECREMENT",
+    "SEMICOLON", "COMMA", "LPAREN", "RPAREN", "LBRACE", "RBRACE", "LBRACKET", "RBRACKET",
+    "INTEGER_LITERAL", "FLOAT_LITERAL", "STRING_LITERAL", "BOOLEAN_LITERAL",
+    "IDENTIFIER",
+    "COMMENT", "END_OF_FILE", "UNKNOWN"
 };
 
+static_assert(sizeof(tokenTypeNameTable) / sizeof(tokenTypeNameTable[0]) == UNKNOWN + 1, 
+              "one name per token type");
+
+// Name of a token type, without allocating (needs no initialization)
+constexpr string_view tokenTypeName(TokenType type) {
+    return (unsigned)type <= UNKNOWN ? tokenTypeNameTable[type] : "UNKNOWN";
+}
+
 // Global map for converting token types to readable strings
 extern map<TokenType, string> tokenTypeNames;
 
 // Utility function to convert TokenType to string
 string tokenTypeToString(TokenType type);
 
-// Function to initialize the token type names map
+// Function to initialize the token type names map (thread-safe, idempotent)
 void initializeTokenTypeNames();
 
 #endif // TOKEN_H
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "token_buffer.h"
+#include <utility>
+
+using namespace std;
+
+TokenBuffer::TokenBuffer() 
+    : typeView(nullptr), offsetView(nullptr), lengthView(nullptr), count(0) {}
+
+void TokenBuffer::reset(string_view src) {
+    source = src;
+    types.clear();
+    offsets.clear();
+    lengths.clear();
+    symbols.clear();
+    typeView = types.data();
+    offsetView = offsets.data();
+    lengthView = lengths.data();
+    count = 0;
+    lines.reset(src);
+}
+
+void TokenBuffer::view(string_view src, const uint8_t* typeData, const uint32_t* offsetData, 
+                       const uint32_t* lengthData, size_t tokenCount, LineIndex&& lineIndex) {
+    reset(src);
+    typeView = typeData;
+    offsetView = offsetData;
+    lengthView = lengthData;
+    count = tokenCount;
+    lines = move(lineIndex);
+}
+
+void TokenBuffer::reserve(size_t count) {
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    symbols.reserve(count);
+}
+
+Token TokenBuffer::token(size_t i) const {
+    return Token(type(i), lexeme(i), offsetView[i], symbols[i]);
+}
+
+size_t TokenBuffer::memoryBytes() const {
+    return types.capacity() * sizeof(uint8_t) + 
+           offsets.capacity() * sizeof(uint32_t) + 
+           lengths.capacity() * sizeof(uint32_t) + 
+           symbols.capacity() * sizeof(SymbolId) + 
+           lines.memoryBytes();
+}
@@ -0,0 +1,89 @@
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "line_index.h"
+#include "token.h"
+
+using namespace std;
+
+// TokenBuffer - struct-of-arrays token storage
+// Each token costs one type byte plus a 32-bit offset and length into the
+// source; lexemes are sliced from the source and line/column are resolved
+// from the line index on demand. Scanning the type array alone touches 64
+// tokens per cache line. Like Token, it views a source it does not own.
+// The arrays are either owned (filled by push) or borrowed from memory
+// such as a mapped token cache (set by view); reads go through the same
+// pointers either way. Identifier tokens also carry the symbol id of
+// their name, kept in an array of its own that is always owned (a cached
+// token stream is interned again when it is loaded).
+class TokenBuffer {
+private:
+    string_view source;         // Source the offsets refer to
+    vector<uint8_t> types;      // TokenType of each token (owned arrays)
+    vector<uint32_t> offsets;   // Byte offset of each lexeme
+    vector<uint32_t> lengths;   // Byte length of each lexeme
+    vector<SymbolId> symbols;   // Symbol of each IDENTIFIER, else NO_SYMBOL
+    const uint8_t* typeView;    // Arrays read by the accessors: the
+    const uint32_t* offsetView; // vectors above, or borrowed memory
+    const uint32_t* lengthView;
+    size_t count;               // Number of tokens
+    LineIndex lines;            // Line starts for position lookups
+    
+    friend class Scanner;
+    friend class EditSession;
+    
+public:
+    TokenBuffer();
+    
+    // The views may point into this object, so it cannot be copied
+    TokenBuffer(const TokenBuffer&) = delete;
+    TokenBuffer& operator=(const TokenBuffer&) = delete;
+    
+    // Drop all tokens and start over for a new source
+    void reset(string_view source);
+    
+    // Preallocate room for count tokens
+    void reserve(size_t count);
+    
+    // Append a token (offset/length are relative to the source)
+    void push(TokenType type, uint32_t offset, uint32_t length, SymbolId symbol = NO_SYMBOL) {
+        types.push_back((uint8_t)type);
+        offsets.push_back(offset);
+        lengths.push_back(length);
+        symbols.push_back(symbol);
+        typeView = types.data();
+        offsetView = offsets.data();
+        lengthView = lengths.data();
+        count++;
+    }
+    
+    // Borrow arrays owned elsewhere (they must outlive the buffer's use)
+    void view(string_view source, const uint8_t* types, const uint32_t* offsets, 
+              const uint32_t* lengths, size_t count, LineIndex&& lines);
+    
+    size_t size() const { return count; }
+    TokenType type(size_t i) const { return (TokenType)typeView[i]; }
+    uint32_t offset(size_t i) const { return offsetView[i]; }
+    uint32_t length(size_t i) const { return lengthView[i]; }
+    SymbolId symbol(size_t i) const { return symbols[i]; }
+    string_view lexeme(size_t i) const { return source.substr(offsetView[i], lengthView[i]); }
+    
+    // Full token (resolve its position through lineIndex())
+    Token token(size_t i) const;
+    
+    // Raw arrays, size() entries each (for serialization)
+    const uint8_t* typeArray() const { return typeView; }
+    const uint32_t* offsetArray() const { return offsetView; }
+    const uint32_t* lengthArray() const { return lengthView; }
+    
+    const LineIndex& lineIndex() const { return lines; }
+    string_view text() const { return source; }
+    
+    // Heap bytes held by the arrays and the line index
+    size_t memoryBytes() const;
+};
+
+#endif // TOKEN_BUFFER_H
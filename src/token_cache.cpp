@@ -0,0 +1,136 @@
+#include "token_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+static const char CACHE_MAGIC[4] = { 'N', 'T', 'O', 'K' };
+
+// Round up to the next 4-byte boundary
+static size_t align4(size_t size) {
+    return (size + 3) & ~(size_t)3;
+}
+
+// File offsets of the arrays that follow the header
+struct CacheLayout {
+    size_t types, offsets, lengths, lineStarts, total;
+    
+    CacheLayout(uint64_t tokenCount, uint64_t lineCount) {
+        types = sizeof(TokenCacheHeader);
+        offsets = align4(types + tokenCount);
+        lengths = offsets + tokenCount * sizeof(uint32_t);
+        lineStarts = lengths + tokenCount * sizeof(uint32_t);
+        total = lineStarts + lineCount * sizeof(uint32_t);
+    }
+};
+
+string TokenCache::pathFor(const string& sourcePath) {
+    size_t dot = sourcePath.find_last_of('.');
+    size_t slash = sourcePath.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) dot = sourcePath.size();
+    return sourcePath.substr(0, dot) + ".ntok";
+}
+
+// Word-at-a-time multiply/xorshift mix; fast enough that checking a cache
+// costs a small fraction of rescanning the source
+uint64_t TokenCache::hashSource(string_view source) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = source.size() * multiplier;
+    size_t i = 0;
+    
+    for (; i + 8 <= source.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, source.data() + i, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+    
+    uint64_t tail = 0;
+    memcpy(&tail, source.data() + i, source.size() - i);
+    hash = (hash ^ tail) * multiplier;
+    return hash ^ (hash >> 32);
+}
+
+bool TokenCache::save(const string& path, string_view source, const TokenBuffer& tokens) {
+    const vector<uint32_t>& lineStarts = tokens.lineIndex().lineStarts();
+    
+    TokenCacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = TOKEN_CACHE_VERSION;
+    header.sourceSize = source.size();
+    header.sourceHash = hashSource(source);
+    header.tokenCount = tokens.size();
+    header.lineCount = lineStarts.size();
+    CacheLayout layout(header.tokenCount, header.lineCount);
+    
+    string temporary = path + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+    
+    static const char padding[4] = {};
+    size_t n = tokens.size();
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(tokens.typeArray(), 1, n, out) == n &&
+              fwrite(padding, 1, layout.offsets - (layout.types + n), out) == layout.offsets - (layout.types + n) &&
+              fwrite(tokens.offsetArray(), sizeof(uint32_t), n, out) == n &&
+              fwrite(tokens.lengthArray(), sizeof(uint32_t), n, out) == n &&
+              fwrite(lineStarts.data(), sizeof(uint32_t), lineStarts.size(), out) == lineStarts.size();
+    ok = fclose(out) == 0 && ok;
+    
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TokenCache::load(const string& path, string_view source, TokenBuffer& tokens) {
+    if (!file.open(path)) return false;
+    string_view data = file.text();
+    
+    TokenCacheHeader header;
+    if (data.size() < sizeof(header)) return false;
+    memcpy(&header, data.data(), sizeof(header));
+    
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TOKEN_CACHE_VERSION ||
+        header.sourceSize != source.size() ||
+        header.tokenCount > data.size() || header.lineCount > data.size() ||
+        header.lineCount == 0) {
+        return false;
+    }
+    
+    CacheLayout layout(header.tokenCount, header.lineCount);
+    if (layout.total != data.size()) return false;
+    
+    // Hash last: it is the only check that reads the whole source
+    if (header.sourceHash != hashSource(source)) return false;
+    
+    // Never let a damaged cache index outside the source
+    const char* base = data.data();
+    const uint8_t* types = (const uint8_t*)(base + layout.types);
+    const uint32_t* offsets = (const uint32_t*)(base + layout.offsets);
+    const uint32_t* lengths = (const uint32_t*)(base + layout.lengths);
+    bool inRange = true;
+    for (size_t i = 0; i < header.tokenCount; i++) {
+        inRange &= types[i] <= UNKNOWN && (uint64_t)offsets[i] + lengths[i] <= source.size();
+    }
+    if (!inRange) return false;
+    
+    // Readers stop at the END_OF_FILE token, so it must be there and last
+    if (header.tokenCount == 0 || types[header.tokenCount - 1] != END_OF_FILE) return false;
+    
+    // LineIndex searches the line starts: they begin at 0 and ascend
+    const uint32_t* lineStarts = (const uint32_t*)(base + layout.lineStarts);
+    bool ascending = lineStarts[0] == 0;
+    for (size_t i = 1; i < header.lineCount; i++) {
+        ascending &= lineStarts[i - 1] < lineStarts[i] && lineStarts[i] <= source.size();
+    }
+    if (!ascending) return false;
+    
+    LineIndex lines;
+    lines.assign(source, lineStarts, header.lineCount);
+    tokens.view(source, types, offsets, lengths, header.tokenCount, move(lines));
+    return true;
+}
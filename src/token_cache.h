@@ -0,0 +1,58 @@
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "source_file.h"
+#include "token_buffer.h"
+
+using namespace std;
+
+// Bump when the file layout or the TokenType numbering changes. Caches
+// written by other versions (or with the other byte order, which makes
+// this field read differently) are ignored and rewritten.
+const uint32_t TOKEN_CACHE_VERSION = 1;
+
+// Fixed header at the start of an .ntok file
+// The arrays follow in this order, each starting on a 4-byte boundary:
+//   uint8_t  types[tokenCount]
+//   uint32_t offsets[tokenCount]
+//   uint32_t lengths[tokenCount]
+//   uint32_t lineStarts[lineCount]
+struct TokenCacheHeader {
+    char magic[4];              // "NTOK"
+    uint32_t version;           // TOKEN_CACHE_VERSION
+    uint64_t sourceSize;        // Length of the source in bytes
+    uint64_t sourceHash;        // hashSource() of the source text
+    uint64_t tokenCount;        // Entries in each token array
+    uint64_t lineCount;         // Entries in lineStarts
+};
+
+// TokenCache - binary token cache for an unchanged source (.ntok)
+// Saving writes the TokenBuffer arrays and the line index behind a header
+// identifying the source. Loading maps the file and points the TokenBuffer
+// at the token arrays in place, so nothing is parsed or copied except the
+// line start table; the cache object keeps the mapping alive.
+class TokenCache {
+private:
+    SourceFile file;            // Mapped .ntok file
+    
+public:
+    // Cache file used for a source path ("dir/x.netc" -> "dir/x.ntok")
+    static string pathFor(const string& sourcePath);
+    
+    // 64-bit hash identifying a source text
+    static uint64_t hashSource(string_view source);
+    
+    // Write tokens (scanned from source) to path; false on I/O failure.
+    // The file is written under a temporary name and renamed into place,
+    // so readers never see a partial cache.
+    static bool save(const string& path, string_view source, const TokenBuffer& tokens);
+    
+    // Map path and make tokens a view of it; false if the file is missing,
+    // malformed or was written for a different source
+    bool load(const string& path, string_view source, TokenBuffer& tokens);
+};
+
+#endif // TOKEN_CACHE_H
@@ -0,0 +1,82 @@
+#include "token_stream.h"
+
+using namespace std;
+
+// List mode - tokens must end with END_OF_FILE (as scanTokens() produces)
+TokenStream::TokenStream(const vector<Token>& toks, const LineIndex& lineIndex) 
+    : tokens(&toks), buffer(nullptr), scanner(nullptr), lines(&lineIndex), position(0), 
+      first(0), last(0), pulled(0) {}
+
+// Buffer mode - the buffer must end with END_OF_FILE (as scanBuffer() does)
+TokenStream::TokenStream(const TokenBuffer& buf) 
+    : tokens(nullptr), buffer(&buf), scanner(nullptr), lines(&buf.lineIndex()), 
+      position(0), first(0), last(buf.size() - 1), pulled(0) {
+    ring.assign(RING_SIZE, Token(END_OF_FILE, "", 0));
+}
+
+// Buffer range mode - the stream ends where token `end` starts
+TokenStream::TokenStream(const TokenBuffer& buf, size_t begin, size_t end) 
+    : tokens(nullptr), buffer(&buf), scanner(nullptr), lines(&buf.lineIndex()), 
+      position(begin), first(begin), last(end), pulled(0) {
+    ring.assign(RING_SIZE, Token(END_OF_FILE, "", 0));
+}
+
+// Streaming mode - tokens are pulled from the scanner on demand
+TokenStream::TokenStream(Scanner& source) 
+    : tokens(nullptr), buffer(nullptr), scanner(&source), lines(&source.lineIndex()), 
+      position(0), first(0), last(0), pulled(0) {
+    ring.assign(RING_SIZE, Token(END_OF_FILE, "", 0));
+}
+
+// Pull tokens from the scanner until `index` is in the ring
+void TokenStream::fill(size_t index) {
+    while (pulled <= index) {
+        // Once the end is reached, keep repeating END_OF_FILE
+        if (pulled > 0 && ring[(pulled - 1) % RING_SIZE].type == END_OF_FILE) {
+            ring[pulled % RING_SIZE] = ring[(pulled - 1) % RING_SIZE];
+        } else {
+            ring[pulled % RING_SIZE] = scanner->nextToken();
+        }
+        pulled++;
+    }
+}
+
+TokenType TokenStream::peekType() {
+    if (buffer) return position < last ? buffer->type(position) : END_OF_FILE;
+    if (tokens) return (*tokens)[position].type;
+    fill(position);
+    return ring[position % RING_SIZE].type;
+}
+
+const Token& TokenStream::peek(size_t ahead) {
+    size_t index = position + ahead;
+    if (buffer) {
+        Token& slot = ring[index % RING_SIZE];
+        if (index < last) {
+            slot = buffer->token(index);
+        } else {
+            uint32_t offset = buffer->offset(last);
+            slot = Token(END_OF_FILE, buffer->text().substr(offset, 0), offset);
+        }
+        return slot;
+    }
+    if (tokens) {
+        return index < tokens->size() ? (*tokens)[index] : tokens->back();
+    }
+    fill(index);
+    return ring[index % RING_SIZE];
+}
+
+const Token& TokenStream::previous() {
+    if (buffer) {
+        Token& slot = ring[(position - 1) % RING_SIZE];
+        slot = buffer->token(position - 1);
+        return slot;
+    }
+    if (tokens) return (*tokens)[position - 1];
+    return ring[(position - 1) % RING_SIZE];
+}
+
+void TokenStream::advance() {
+    if (peekType() != END_OF_FILE) position++;
+}
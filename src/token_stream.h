@@ -0,0 +1,67 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+#include "scanner.h"
+
+using namespace std;
+
+// TokenStream - sequential token access for the Parser
+// Reads from an already scanned token list, from a struct-of-arrays
+// TokenBuffer, or straight from a Scanner. In the streaming case only a
+// small ring of recent tokens is kept, so scanning and parsing interleave
+// and memory stays bounded. In buffer mode type checks read the dense type
+// array and full tokens are only materialized (into the ring) on request.
+class TokenStream {
+public:
+    static const size_t RING_SIZE = 4;      // Power of two
+    static const size_t MAX_LOOKAHEAD = RING_SIZE - 2;
+    
+private:
+    const vector<Token>* tokens;    // Scanned token list (list mode)
+    const TokenBuffer* buffer;      // Scanned token arrays (buffer mode)
+    Scanner* scanner;               // Token source (streaming mode)
+    const LineIndex* lines;         // Positions for the tokens
+    vector<Token> ring;             // Recent tokens, indexed by position % RING_SIZE
+    size_t position;                // Index of the current token
+    size_t first;                   // First token of the range (buffer mode)
+    size_t last;                    // Token read as END_OF_FILE (buffer mode)
+    size_t pulled;                  // Number of tokens taken from the scanner
+    
+    void fill(size_t index);        // Pull tokens until index is available
+    
+public:
+    TokenStream(const vector<Token>& tokens, const LineIndex& lines);
+    TokenStream(const TokenBuffer& buffer);
+    // Tokens [first, last) of a buffer, with token last read as END_OF_FILE
+    TokenStream(const TokenBuffer& buffer, size_t first, size_t last);
+    TokenStream(Scanner& scanner);
+    
+    // Type of the current token (cheapest check in every mode)
+    TokenType peekType();
+    
+    // Token `ahead` positions past the current one (ahead <= MAX_LOOKAHEAD)
+    const Token& peek(size_t ahead = 0);
+    
+    // Token before the current one (only valid after advance())
+    const Token& previous();
+    
+    // Move to the next token (never moves past END_OF_FILE)
+    void advance();
+    
+    // Line and column of a token from this stream
+    SourcePosition positionOf(const Token& token) const { return lines->position(token); }
+    
+    // Token arrays read in buffer mode (nullptr in the other modes)
+    const TokenBuffer* tokenBuffer() const { return buffer; }
+    
+    // Source text the tokens point into
+    string_view sourceText() const { return lines->text(); }
+    
+    // Number of tokens consumed so far, including the current one
+    size_t count() const { return position - first + 1; }
+};
+
+#endif // TOKEN_STREAM_H
@@ -0,0 +1,65 @@
+#include "token_writer.h"
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+// Longest row prefix: two ints, the longest type name and five tabs
+static const size_t MAX_ROW_PREFIX = 2 * 11 + 16 + 5;
+
+TokenWriter::TokenWriter(FILE* output, TokenTableStyle tableStyle) 
+    : out(output), block(BLOCK_SIZE), used(0), style(tableStyle) {}
+
+TokenWriter::~TokenWriter() {
+    flush();
+}
+
+void TokenWriter::flush() {
+    if (used == 0) return;
+    fwrite(block.data(), 1, used, out);
+    used = 0;
+}
+
+void TokenWriter::write(string_view text) {
+    if (text.size() > BLOCK_SIZE - used) {
+        flush();
+        
+        // Too big to buffer at all: write it through
+        if (text.size() > BLOCK_SIZE) {
+            fwrite(text.data(), 1, text.size(), out);
+            return;
+        }
+    }
+    memcpy(block.data() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void TokenWriter::writeToken(SourcePosition position, TokenType type, string_view lexeme) {
+    if (BLOCK_SIZE - used < MAX_ROW_PREFIX) flush();
+    
+    char* p = block.data() + used;
+    char* end = block.data() + BLOCK_SIZE;
+    p = to_chars(p, end, position.line).ptr;
+    *p++ = '\t';
+    p = to_chars(p, end, position.column).ptr;
+    *p++ = '\t';
+    
+    string_view name = tokenTypeName(type);
+    memcpy(p, name.data(), name.size());
+    p += name.size();
+    
+    if (style == TokenTableStyle::File) {
+        *p++ = '\t';
+        *p++ = '\t';
+    }
+    
+    // Extra tabs keep short type names aligned
+    if (name.size() < 16) *p++ = '\t';
+    if (name.size() < 8) *p++ = '\t';
+    used = p - block.data();
+    
+    write(lexeme);
+    
+    if (used == BLOCK_SIZE) flush();
+    block[used++] = '\n';
+}
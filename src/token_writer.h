@@ -0,0 +1,50 @@
+#ifndef TOKEN_WRITER_H
+#define TOKEN_WRITER_H
+
+#include <cstdio>
+#include <string_view>
+#include <vector>
+#include "token.h"
+#include "line_index.h"
+
+using namespace std;
+
+// Column layout of a token table (the two existing outputs differ)
+enum class TokenTableStyle {
+    Console,    // Scanner::printTokens: "TYPE" + alignment tabs
+    File        // <file>_tokens.txt: "TYPE\t\t" + alignment tabs
+};
+
+// TokenWriter - fast formatter for token tables
+// Rows are formatted straight into a preallocated block with to_chars and
+// the constexpr token type names, and each full block goes out in one
+// fwrite, so dumping millions of tokens costs a few large writes instead
+// of several stream insertions per token.
+class TokenWriter {
+public:
+    static const size_t BLOCK_SIZE = 1 << 20;
+    
+private:
+    FILE* out;                  // Destination (not owned)
+    vector<char> block;         // Formatting buffer, BLOCK_SIZE bytes
+    size_t used;                // Bytes of block filled so far
+    TokenTableStyle style;      // Row layout
+    
+public:
+    TokenWriter(FILE* out, TokenTableStyle style);
+    ~TokenWriter();             // Flushes what is left
+    
+    TokenWriter(const TokenWriter&) = delete;
+    TokenWriter& operator=(const TokenWriter&) = delete;
+    
+    // Append raw text
+    void write(string_view text);
+    
+    // Append one row: line, column, type name, alignment tabs, lexeme
+    void writeToken(SourcePosition position, TokenType type, string_view lexeme);
+    
+    // Write out the buffered block
+    void flush();
+};
+
+#endif // TOKEN_WRITER_H
@@ -0,0 +1,410 @@
+#include "tree_interpreter.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Current position of the native stack
+static uintptr_t stackPosition() {
+#if defined(__GNUC__)
+    return (uintptr_t)__builtin_frame_address(0);
+#else
+    volatile char marker = 0;
+    return (uintptr_t)&marker;
+#endif
+}
+
+// Bytes the native stack of this thread may grow to
+static size_t stackLimit() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0) {
+        // An unlimited stack still has to fit between other mappings
+        if (limit.rlim_cur == RLIM_INFINITY) return TreeInterpreter::UNLIMITED_STACK_LIMIT;
+        return limit.rlim_cur;
+    }
+#endif
+    return TreeInterpreter::DEFAULT_STACK_LIMIT;
+}
+
+// Bytes below run()'s frame a program may use, keeping STACK_RESERVE for
+// the callers above it and the frames of the statement that faults
+static size_t usableStack() {
+    size_t limit = stackLimit();
+    size_t reserve = TreeInterpreter::STACK_RESERVE;
+    return limit > 2 * reserve ? limit - reserve : limit / 2;
+}
+
+TreeInterpreter::TreeInterpreter(const Ast& tree, const Resolver& names, const TypeChecker& types,
+                                 const LineIndex& index, FILE* in, FILE* out)
+    : ast(tree), resolver(names), checker(types), lines(index), io(in, out),
+      yieldType(ValueType::Void), atTopLevel(false), yielding(false), failed(false),
+      yielded(zero(ValueType::Void)), resultValue(zero(ValueType::Void)), hasResultValue(false),
+      calls(0), stackBase(0), stackBudget(usableStack()) {}
+
+void TreeInterpreter::fault(NodeId at, const string& message) {
+    if (failed) return;
+    failed = true;
+    SourcePosition position = lines.position(ast.node(at).offset, 1);
+    diagnostics.report(DiagnosticPhase::Runtime, position.line, position.column, message);
+}
+
+// Fault before the native stack runs out (it grows down from stackBase)
+bool TreeInterpreter::nestingExceeded(NodeId at) {
+    if (stackBase - stackPosition() < stackBudget) return false;
+    fault(at, "Statements and expressions nest too deeply to run");
+    return true;
+}
+
+TreeInterpreter::TreeValue TreeInterpreter::zero(ValueType type) {
+    TreeValue value;
+    value.type = type;
+    value.value.dnum = 0;
+    return value;
+}
+
+// A value stored into something of type `type` (dnums and cnums convert)
+TreeInterpreter::TreeValue TreeInterpreter::convert(TreeValue value, ValueType type) {
+    if (type == ValueType::Cnum && value.type == ValueType::Dnum) {
+        value.value.cnum = (double)value.value.dnum;
+    } else if (type == ValueType::Dnum && value.type == ValueType::Cnum) {
+        value.value.dnum = cnumToDnum(value.value.cnum);
+    }
+    value.type = type;
+    return value;
+}
+
+TreeInterpreter::TreeValue& TreeInterpreter::variable(NodeId declaration) {
+    auto local = frames.back().find(declaration);
+    if (local != frames.back().end()) return local->second;
+    return globals[declaration];
+}
+
+string TreeInterpreter::result() const {
+    return resultValue.type == ValueType::Text ? resultValue.text : formatValue(resultValue.type, resultValue.value);
+}
+
+// ==================== Program ====================
+
+bool TreeInterpreter::run() {
+    stackBase = stackPosition();
+    NodeId entry = NO_NODE;
+    for (NodeId id = 1; id <= ast.size() && entry == NO_NODE; id++) {
+        if (ast.node(id).kind == NodeKind::Init) entry = id;
+    }
+    
+    // The top-level statements, then init()
+    frames.emplace_back();
+    atTopLevel = true;
+    statements(ast.node(ast.getRoot()).a);
+    atTopLevel = false;
+    
+    if (!yielding && !failed && entry != NO_NODE) {
+        frames.emplace_back();
+        yieldType = checker.typeOf(entry);
+        calls++;
+        statements(ast.node(entry).a);
+        if (!failed && yieldType != ValueType::Void) {
+            resultValue = yielding ? yielded : zero(yieldType);
+            hasResultValue = true;
+        }
+        frames.pop_back();
+    }
+    
+    io.flush();
+    frames.clear();
+    return !failed;
+}
+
+// ==================== Expressions ====================
+
+TreeInterpreter::TreeValue TreeInterpreter::evaluate(NodeId id) {
+    if (nestingExceeded(id)) return zero(ValueType::Unknown);
+    const Node& node = ast.node(id);
+    TreeValue value;
+    
+    switch (node.kind) {
+        case NodeKind::IntLiteral:
+            value.type = ValueType::Dnum;
+            value.value.dnum = ast.intValue(id);
+            return value;
+        case NodeKind::FloatLiteral:
+            value.type = ValueType::Cnum;
+            value.value.cnum = ast.floatValue(id);
+            return value;
+        case NodeKind::StringLiteral: {
+            string_view literal = ast.text(id);
+            value.type = ValueType::Text;
+            value.value.dnum = 0;
+            value.text = string(literal.substr(1, literal.size() - 2));
+            return value;
+        }
+        case NodeKind::BoolLiteral:
+            value.type = ValueType::Flag;
+            value.value.dnum = node.a;
+            return value;
+        case NodeKind::Identifier:
+            return variable(resolver.declarationOf(id));
+        case NodeKind::Call:
+            return call(id);
+        case NodeKind::Unary:
+            return unary(id);
+        case NodeKind::Binary:
+            return binary(id);
+        default:
+            return zero(ValueType::Unknown);
+    }
+}
+
+TreeInterpreter::TreeValue TreeInterpreter::call(NodeId id) {
+    const Node& node = ast.node(id);
+    NodeId network = resolver.declarationOf(id);
+    ValueType type = checker.typeOf(network);
+    
+    vector<TreeValue> args;
+    for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) {
+        args.push_back(evaluate(arg));
+    }
+    if (failed) return zero(type);
+    if (frames.size() > MAX_CALL_DEPTH) {
+        fault(id, "Too many nested calls (more than " + to_string(MAX_CALL_DEPTH) + ")");
+        return zero(type);
+    }
+    
+    unordered_map<NodeId, TreeValue> locals;
+    size_t position = 0;
+    for (NodeId param = ast.node(network).a; param != NO_NODE; param = ast.node(param).next) {
+        // The resolver matched the lists, but args is indexed by it
+        if (position == args.size()) {
+            fault(id, "Network '" + string(ast.text(id)) + "' got too few arguments");
+            return zero(type);
+        }
+        locals[param] = convert(args[position++], checker.typeOf(param));
+    }
+    
+    ValueType outerType = yieldType;
+    frames.push_back(move(locals));
+    yieldType = type;
+    calls++;
+    statements(ast.node(network).b);
+    
+    TreeValue value = yielding ? yielded : zero(type);
+    yielding = false;
+    yieldType = outerType;
+    frames.pop_back();
+    return value;
+}
+
+TreeInterpreter::TreeValue TreeInterpreter::unary(NodeId id) {
+    const Node& node = ast.node(id);
+    
+    // ++ and -- on a variable update it, as in C
+    if (node.op == INCREMENT || node.op == DECREMENT) {
+        int step = node.op == INCREMENT ? 1 : -1;
+        if (ast.node(node.a).kind == NodeKind::Identifier) {
+            TreeValue& target = variable(resolver.declarationOf(node.a));
+            if (target.type == ValueType::Cnum) target.value.cnum += step;
+            else target.value.dnum = wrapAdd(target.value.dnum, step);
+            return target;
+        }
+        TreeValue value = evaluate(node.a);
+        if (value.type == ValueType::Cnum) value.value.cnum += step;
+        else value.value.dnum = wrapAdd(value.value.dnum, step);
+        return value;
+    }
+    
+    TreeValue value = evaluate(node.a);
+    switch (node.op) {
+        case NOT:
+            value.value.dnum = !value.value.dnum;
+            break;
+        case BITWISE_NOT:
+            value.value.dnum = ~value.value.dnum;
+            break;
+        default:
+            if (value.type == ValueType::Cnum) value.value.cnum = -value.value.cnum;
+            else value.value.dnum = wrapNeg(value.value.dnum);
+            break;
+    }
+    return value;
+}
+
+TreeInterpreter::TreeValue TreeInterpreter::binary(NodeId id) {
+    const Node& node = ast.node(id);
+    TreeValue result = zero(ValueType::Flag);
+    
+    // && and || skip their right operand when the left one decides
+    if (node.op == AND || node.op == OR) {
+        TreeValue left = evaluate(node.a);
+        if ((left.value.dnum != 0) == (node.op == OR)) return left;
+        return evaluate(node.b);
+    }
+    
+    TreeValue left = evaluate(node.a);
+    TreeValue right = evaluate(node.b);
+    if (failed) return result;
+    
+    if (left.type == ValueType::Text) {
+        if (node.op == PLUS) {
+            left.text += right.text;
+            return left;
+        }
+        result.value.dnum = (left.text == right.text) == (node.op == EQ);
+        return result;
+    }
+    
+    // Mixed dnum and cnum operands are both taken as cnums
+    if (left.type == ValueType::Cnum || right.type == ValueType::Cnum) {
+        double a = left.type == ValueType::Cnum ? left.value.cnum : (double)left.value.dnum;
+        double b = right.type == ValueType::Cnum ? right.value.cnum : (double)right.value.dnum;
+        switch (node.op) {
+            case EQ: result.value.dnum = a == b; return result;
+            case NEQ: result.value.dnum = a != b; return result;
+            case LT: result.value.dnum = a < b; return result;
+            case GT: result.value.dnum = a > b; return result;
+            case LTE: result.value.dnum = a <= b; return result;
+            case GTE: result.value.dnum = a >= b; return result;
+            default: break;
+        }
+        result.type = ValueType::Cnum;
+        switch (node.op) {
+            case PLUS: result.value.cnum = a + b; break;
+            case MINUS: result.value.cnum = a - b; break;
+            case MULTIPLY: result.value.cnum = a * b; break;
+            default: result.value.cnum = a / b; break;     // DIVIDE
+        }
+        return result;
+    }
+    
+    int64_t a = left.value.dnum;
+    int64_t b = right.value.dnum;
+    switch (node.op) {
+        case EQ: result.value.dnum = a == b; return result;
+        case NEQ: result.value.dnum = a != b; return result;
+        case LT: result.value.dnum = a < b; return result;
+        case GT: result.value.dnum = a > b; return result;
+        case LTE: result.value.dnum = a <= b; return result;
+        case GTE: result.value.dnum = a >= b; return result;
+        default: break;
+    }
+    result.type = ValueType::Dnum;
+    switch (node.op) {
+        case PLUS: result.value.dnum = wrapAdd(a, b); break;
+        case MINUS: result.value.dnum = wrapSub(a, b); break;
+        case MULTIPLY: result.value.dnum = wrapMul(a, b); break;
+        case DIVIDE:
+            if (b == 0) fault(id, "Division by zero");
+            else result.value.dnum = wrapDiv(a, b);
+            break;
+        case MODULO:
+            if (b == 0) fault(id, "Modulo by zero");
+            else result.value.dnum = wrapMod(a, b);
+            break;
+        case BITWISE_AND: result.value.dnum = a & b; break;
+        case BITWISE_OR: result.value.dnum = a | b; break;
+        case BITWISE_XOR: result.value.dnum = a ^ b; break;
+        case LEFT_SHIFT: result.value.dnum = shiftLeft(a, b); break;
+        default: result.value.dnum = shiftRight(a, b); break;   // RIGHT_SHIFT
+    }
+    return result;
+}
+
+// ==================== Statements ====================
+
+void TreeInterpreter::block(NodeId first) {
+    bool outer = atTopLevel;
+    atTopLevel = false;
+    statements(first);
+    atTopLevel = outer;
+}
+
+void TreeInterpreter::statements(NodeId first) {
+    for (NodeId id = first; id != NO_NODE && !yielding && !failed; id = ast.node(id).next) {
+        execute(id);
+    }
+}
+
+void TreeInterpreter::execute(NodeId id) {
+    if (nestingExceeded(id)) return;
+    const Node& node = ast.node(id);
+    
+    switch (node.kind) {
+        case NodeKind::Declaration: {
+            ValueType type = checker.typeOf(id);
+            TreeValue value = node.a != NO_NODE ? convert(evaluate(node.a), type) : zero(type);
+            if (atTopLevel) globals[id] = value;
+            else frames.back()[id] = value;
+            break;
+        }
+        case NodeKind::Assign: {
+            NodeId declaration = resolver.declarationOf(id);
+            TreeValue value = convert(evaluate(node.a), checker.typeOf(declaration));
+            variable(declaration) = value;
+            break;
+        }
+        case NodeKind::Feed: {
+            NodeId declaration = resolver.declarationOf(id);
+            TreeValue value = zero(checker.typeOf(declaration));
+            switch (value.type) {
+                case ValueType::Cnum: value.value.cnum = io.feedCnum(); break;
+                case ValueType::Flag: value.value.dnum = io.feedFlag(); break;
+                case ValueType::Text: value.text = io.feedText(); break;
+                default: value.value.dnum = io.feedDnum(); break;
+            }
+            variable(declaration) = value;
+            break;
+        }
+        case NodeKind::Forward: {
+            TreeValue value = evaluate(node.a);
+            if (failed) break;
+            switch (value.type) {
+                case ValueType::Cnum: io.forwardCnum(value.value.cnum); break;
+                case ValueType::Flag: io.forwardFlag(value.value.dnum != 0); break;
+                case ValueType::Text: io.forwardText(value.text); break;
+                default: io.forwardDnum(value.value.dnum); break;
+            }
+            break;
+        }
+        case NodeKind::Yield: {
+            // A yield outside any network ends the program without a result
+            TreeValue value = evaluate(node.a);
+            yielded = frames.size() > 1 ? convert(value, yieldType) : zero(ValueType::Void);
+            yielding = true;
+            break;
+        }
+        case NodeKind::If: {
+            TreeValue condition = evaluate(node.a);
+            if (failed) break;
+            block(condition.value.dnum ? node.b : node.c);
+            break;
+        }
+        case NodeKind::Until:
+            // Runs while the condition is false, tested before each pass
+            while (!yielding && !failed) {
+                TreeValue condition = evaluate(node.a);
+                if (failed || condition.value.dnum) break;
+                block(node.b);
+            }
+            break;
+        case NodeKind::Iterate: {
+            bool outer = atTopLevel;
+            atTopLevel = false;
+            if (node.a != NO_NODE) execute(node.a);
+            while (!yielding && !failed) {
+                if (node.b != NO_NODE) {
+                    TreeValue condition = evaluate(node.b);
+                    if (failed || !condition.value.dnum) break;
+                }
+                block(node.d);
+                if (yielding || failed) break;
+                if (node.c != NO_NODE) execute(node.c);
+            }
+            atTopLevel = outer;
+            break;
+        }
+        default:
+            // Networks and init() run when called; links do nothing
+            break;
+    }
+}
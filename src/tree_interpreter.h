@@ -0,0 +1,96 @@
+#ifndef TREE_INTERPRETER_H
+#define TREE_INTERPRETER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "diagnostics.h"
+#include "line_index.h"
+#include "resolver.h"
+#include "runtime.h"
+#include "type_checker.h"
+
+using namespace std;
+
+// TreeInterpreter - runs a checked program by walking its syntax tree
+// The straightforward way to execute NetC, kept as the reference the VM is
+// measured and checked against (--run=tree): every value carries its
+// type, every operation looks at those types, variables live in a hash
+// map per call keyed by their declaration, and every node is a recursive
+// call. It follows the VM's semantics exactly, so both write the same
+// output for the same input.
+class TreeInterpreter {
+public:
+    // Calls recurse on the native stack, so they nest less deeply than in the VM
+    static const size_t MAX_CALL_DEPTH = 2000;
+    // So do statements and expressions, in every active call together. The
+    // checker bounds one expression, but not a tall one in a deep
+    // recursion, so the program faults once the thread's stack limit (read
+    // where the platform allows) is within STACK_RESERVE bytes
+    static const size_t STACK_RESERVE = 512 << 10;
+    static const size_t DEFAULT_STACK_LIMIT = 1 << 20;
+    static const size_t UNLIMITED_STACK_LIMIT = 64 << 20;
+    
+private:
+    struct TreeValue {
+        ValueType type;
+        Value value;
+        string text;
+    };
+    
+    const Ast& ast;
+    const Resolver& resolver;
+    const TypeChecker& checker;
+    const LineIndex& lines;
+    ProgramIO io;
+    Diagnostics diagnostics;
+    
+    unordered_map<NodeId, TreeValue> globals;
+    vector<unordered_map<NodeId, TreeValue>> frames;   // Locals of each active call
+    ValueType yieldType;            // What the current call yields
+    bool atTopLevel;                // Declarations are globals
+    bool yielding;                  // A yield is unwinding the current call
+    bool failed;                    // A runtime error stopped the program
+    TreeValue yielded;
+    TreeValue resultValue;
+    bool hasResultValue;
+    size_t calls;
+    uintptr_t stackBase;            // Native stack position when run() started
+    size_t stackBudget;             // Bytes below it the program may use
+    
+    void fault(NodeId at, const string& message);
+    bool nestingExceeded(NodeId at);
+    static TreeValue zero(ValueType type);
+    static TreeValue convert(TreeValue value, ValueType type);
+    TreeValue& variable(NodeId declaration);
+    
+    TreeValue evaluate(NodeId id);
+    TreeValue call(NodeId id);
+    TreeValue unary(NodeId id);
+    TreeValue binary(NodeId id);
+    
+    void block(NodeId first);
+    void statements(NodeId first);
+    void execute(NodeId id);
+    
+public:
+    // The checker must have checked ast without errors
+    TreeInterpreter(const Ast& ast, const Resolver& resolver, const TypeChecker& checker,
+                    const LineIndex& lines, FILE* in, FILE* out);
+    
+    // Run the program to its end; false on a runtime error
+    bool run();
+    
+    // What init() yielded, as forward would write it
+    bool hasResult() const { return hasResultValue; }
+    string result() const;
+    
+    size_t callCount() const { return calls; }
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    bool hasError() const { return !diagnostics.empty(); }
+};
+
+#endif // TREE_INTERPRETER_H
@@ -0,0 +1,420 @@
+#include "type_checker.h"
+#include <algorithm>
+#include "parser.h"
+
+using namespace std;
+
+const char* valueTypeName(ValueType type) {
+    switch (type) {
+        case ValueType::Dnum: return "dnum";
+        case ValueType::Cnum: return "cnum";
+        case ValueType::Text: return "text";
+        case ValueType::Flag: return "flag";
+        case ValueType::Void: return "no value";
+        default: return "unknown";
+    }
+}
+
+// Type named by a data type keyword (Declaration/Param op)
+static ValueType declaredType(uint8_t dataType) {
+    switch (dataType) {
+        case DNUM: return ValueType::Dnum;
+        case CNUM: return ValueType::Cnum;
+        case TEXT: return ValueType::Text;
+        case FLAG: return ValueType::Flag;
+        default: return ValueType::Unknown;
+    }
+}
+
+static bool isNumeric(ValueType type) {
+    return type == ValueType::Dnum || type == ValueType::Cnum;
+}
+
+// Type of two yields of one body together (or of the operands of an
+// arithmetic operator); the first wins when they cannot be joined
+static ValueType join(ValueType a, ValueType b) {
+    if (a == ValueType::Unknown) return b;
+    if (b == ValueType::Unknown || a == b) return a;
+    if (isNumeric(a) && isNumeric(b)) return ValueType::Cnum;
+    return a;
+}
+
+TypeChecker::TypeChecker(const Ast& tree, const Resolver& names, const LineIndex& index)
+    : ast(tree), resolver(names), lines(index), types(tree.size() + 1, ValueType::Unknown),
+      bodyOf(tree.size() + 1, 0), heights(tree.size() + 1, 0), maxDepth(Parser::DEFAULT_MAX_DEPTH),
+      quiet(false), typed(0) {}
+
+void TypeChecker::error(NodeId at, const string& message) {
+    if (quiet) return;
+    const Node& node = ast.node(at);
+    SourcePosition position = lines.position(node.offset, node.length);
+    diagnostics.report(DiagnosticPhase::Semantic, position.line, position.column, message);
+}
+
+// Numbers convert both ways, as in C (a cnum stored in a dnum is truncated)
+bool TypeChecker::assignable(ValueType to, ValueType from) const {
+    return to == ValueType::Unknown || from == ValueType::Unknown || to == from ||
+           (isNumeric(to) && isNumeric(from));
+}
+
+// ==================== Return Types ====================
+
+// Yields of a body, not counting those of networks defined inside it
+void TypeChecker::collectYields(NodeId first) {
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) {
+        const Node& node = ast.node(id);
+        switch (node.kind) {
+            case NodeKind::Yield:
+                yields.push_back(id);
+                break;
+            case NodeKind::If:
+                collectYields(node.b);
+                collectYields(node.c);
+                break;
+            case NodeKind::Until:
+                collectYields(node.b);
+                break;
+            case NodeKind::Iterate:
+                collectYields(node.d);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Networks called anywhere in an expression, left to right
+void TypeChecker::collectCalls(NodeId id) {
+    if (id == NO_NODE) return;
+    pendingCalls.assign(1, id);
+    
+    while (!pendingCalls.empty()) {
+        NodeId current = pendingCalls.back();
+        pendingCalls.pop_back();
+        const Node& node = ast.node(current);
+        
+        switch (node.kind) {
+            case NodeKind::Call: {
+                if (resolver.declarationOf(current) != NO_NODE) callees.push_back(resolver.declarationOf(current));
+                size_t firstArg = pendingCalls.size();
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) pendingCalls.push_back(arg);
+                reverse(pendingCalls.begin() + firstArg, pendingCalls.end());
+                break;
+            }
+            case NodeKind::Unary:
+                if (node.a != NO_NODE) pendingCalls.push_back(node.a);
+                break;
+            case NodeKind::Binary:
+                if (node.b != NO_NODE) pendingCalls.push_back(node.b);
+                if (node.a != NO_NODE) pendingCalls.push_back(node.a);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Infer every body's return type, callees first. The walk over the call
+// graph keeps its own stack, so a long chain of networks calling each
+// other cannot overflow the native one.
+void TypeChecker::inferReturnTypes() {
+    for (NodeId id = 1; id <= ast.size(); id++) {
+        const Node& node = ast.node(id);
+        if (node.kind != NodeKind::Network && node.kind != NodeKind::Init) continue;
+        
+        Body body = {id, (uint32_t)yields.size(), 0, (uint32_t)callees.size(), 0, 0};
+        collectYields(node.kind == NodeKind::Network ? node.b : node.a);
+        body.yieldEnd = yields.size();
+        for (uint32_t i = body.firstYield; i < body.yieldEnd; i++) collectCalls(ast.node(yields[i]).a);
+        body.callEnd = callees.size();
+        
+        bodyOf[id] = bodies.size();
+        bodies.push_back(body);
+    }
+    
+    vector<pair<uint32_t, uint32_t>> stack;     // Body index, next callee
+    for (uint32_t root = 0; root < bodies.size(); root++) {
+        if (bodies[root].state != 0) continue;
+        bodies[root].state = 1;
+        stack.push_back({root, bodies[root].firstCall});
+        
+        while (!stack.empty()) {
+            uint32_t index = stack.back().first;
+            uint32_t next = stack.back().second;
+            if (next < bodies[index].callEnd) {
+                stack.back().second++;
+                Body& callee = bodies[bodyOf[callees[next]]];
+                if (callee.state == 0) {
+                    callee.state = 1;
+                    stack.push_back({bodyOf[callees[next]], callee.firstCall});
+                }
+                continue;
+            }
+            inferReturnType(bodies[index]);
+            bodies[index].state = 2;
+            stack.pop_back();
+        }
+    }
+}
+
+void TypeChecker::inferReturnType(Body& body) {
+    ValueType result = body.firstYield == body.yieldEnd ? ValueType::Void : ValueType::Unknown;
+    
+    quiet = true;
+    for (uint32_t i = body.firstYield; i < body.yieldEnd; i++) {
+        result = join(result, expressionType(ast.node(yields[i]).a));
+    }
+    quiet = false;
+    types[body.node] = result;
+}
+
+// ==================== Expressions ====================
+
+// Type id and everything under it, operands left to right, in the order
+// a recursive walk would: a call's arguments are each checked once typed
+ValueType TypeChecker::expressionType(NodeId id) {
+    if (id == NO_NODE) return ValueType::Unknown;
+    steps.assign(1, {StepKind::Visit, id, NO_NODE, NO_NODE, 0});
+    
+    while (!steps.empty()) {
+        Step step = steps.back();
+        steps.pop_back();
+        const Node& node = ast.node(step.id);
+        
+        if (step.kind == StepKind::Argument) {
+            checkArgument(step);
+            continue;
+        }
+        bool operands = node.kind == NodeKind::Call || node.kind == NodeKind::Unary || node.kind == NodeKind::Binary;
+        if (step.kind == StepKind::Visit && operands) {
+            // Pushed in evaluation order, then reversed so the first runs first
+            steps.push_back({StepKind::Finish, step.id, NO_NODE, NO_NODE, 0});
+            size_t first = steps.size();
+            if (node.kind == NodeKind::Call) {
+                NodeId network = resolver.declarationOf(step.id);
+                NodeId param = network != NO_NODE ? ast.node(network).a : NO_NODE;
+                uint32_t position = 1;
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next, position++) {
+                    steps.push_back({StepKind::Visit, arg, NO_NODE, NO_NODE, 0});
+                    steps.push_back({StepKind::Argument, arg, step.id, param, position});
+                    if (param != NO_NODE) param = ast.node(param).next;
+                }
+            } else {
+                if (node.a != NO_NODE) steps.push_back({StepKind::Visit, node.a, NO_NODE, NO_NODE, 0});
+                if (node.b != NO_NODE) steps.push_back({StepKind::Visit, node.b, NO_NODE, NO_NODE, 0});
+            }
+            reverse(steps.begin() + first, steps.end());
+            continue;
+        }
+        
+        // Operators report the nesting past the limit once, where it starts
+        if (operands) {
+            uint32_t height = 0;
+            if (node.kind == NodeKind::Call) {
+                for (NodeId arg = node.a; arg != NO_NODE; arg = ast.node(arg).next) height = max(height, heights[arg]);
+            } else {
+                height = max(heights[node.a], heights[node.b]);
+            }
+            heights[step.id] = height + 1;
+            if (height == maxDepth) {
+                error(step.id, "Expression nesting exceeds the maximum depth of " + to_string(maxDepth));
+            }
+        }
+        
+        ValueType type = ValueType::Unknown;
+        switch (node.kind) {
+            case NodeKind::IntLiteral: type = ValueType::Dnum; break;
+            case NodeKind::FloatLiteral: type = ValueType::Cnum; break;
+            case NodeKind::StringLiteral: type = ValueType::Text; break;
+            case NodeKind::BoolLiteral: type = ValueType::Flag; break;
+            case NodeKind::Identifier: {
+                NodeId declaration = resolver.declarationOf(step.id);
+                if (declaration != NO_NODE) type = declaredType(ast.node(declaration).op);
+                break;
+            }
+            case NodeKind::Call: type = callType(step.id); break;
+            case NodeKind::Unary: type = unaryType(step.id); break;
+            case NodeKind::Binary: type = binaryType(step.id); break;
+            default: break;
+        }
+        
+        if (!quiet) typed++;
+        types[step.id] = type;
+    }
+    return types[id];
+}
+
+// An argument, once typed, against its parameter (the resolver checked the count)
+void TypeChecker::checkArgument(const Step& step) {
+    if (step.param == NO_NODE) return;
+    ValueType type = types[step.id];
+    ValueType expected = declaredType(ast.node(step.param).op);
+    if (!assignable(expected, type)) {
+        error(step.id, "Argument " + to_string(step.position) + " of '" + string(ast.text(step.call)) +
+                       "' must be " + valueTypeName(expected) + ", got " + valueTypeName(type));
+    }
+}
+
+// A call whose arguments have been typed and checked
+ValueType TypeChecker::callType(NodeId id) {
+    NodeId network = resolver.declarationOf(id);
+    
+    // Linked networks, and ones still being inferred, are Unknown
+    if (network == NO_NODE || bodies[bodyOf[network]].state != 2) return ValueType::Unknown;
+    ValueType result = types[network];
+    if (result == ValueType::Void) {
+        error(id, "Network '" + string(ast.text(id)) + "' does not yield a value");
+        return ValueType::Unknown;
+    }
+    return result;
+}
+
+ValueType TypeChecker::unaryType(NodeId id) {
+    const Node& node = ast.node(id);
+    ValueType operand = types[node.a];
+    if (operand == ValueType::Unknown) return ValueType::Unknown;
+    
+    bool valid;
+    switch (node.op) {
+        case NOT: valid = operand == ValueType::Flag; break;
+        case BITWISE_NOT: valid = operand == ValueType::Dnum; break;
+        default: valid = isNumeric(operand); break;     // - ++ --
+    }
+    if (!valid) {
+        error(id, "Operator '" + string(ast.text(id)) + "' cannot be applied to " + valueTypeName(operand));
+        return ValueType::Unknown;
+    }
+    return operand;
+}
+
+ValueType TypeChecker::binaryType(NodeId id) {
+    const Node& node = ast.node(id);
+    ValueType left = types[node.a];
+    ValueType right = types[node.b];
+    if (left == ValueType::Unknown || right == ValueType::Unknown) {
+        // Comparisons and logic still give a flag whatever their operands
+        bool flag = node.op == EQ || node.op == NEQ || node.op == LT || node.op == GT ||
+                    node.op == LTE || node.op == GTE || node.op == AND || node.op == OR;
+        return flag ? ValueType::Flag : ValueType::Unknown;
+    }
+    
+    ValueType result;
+    switch (node.op) {
+        case PLUS:
+            // + also joins two texts
+            result = isNumeric(left) && isNumeric(right) ? join(left, right) :
+                     left == ValueType::Text && right == ValueType::Text ? ValueType::Text :
+                     ValueType::Unknown;
+            break;
+        case MINUS: case MULTIPLY: case DIVIDE:
+            result = isNumeric(left) && isNumeric(right) ? join(left, right) : ValueType::Unknown;
+            break;
+        case MODULO: case BITWISE_AND: case BITWISE_OR: case BITWISE_XOR:
+        case LEFT_SHIFT: case RIGHT_SHIFT:
+            result = left == ValueType::Dnum && right == ValueType::Dnum ? ValueType::Dnum : ValueType::Unknown;
+            break;
+        case LT: case GT: case LTE: case GTE:
+            result = isNumeric(left) && isNumeric(right) ? ValueType::Flag : ValueType::Unknown;
+            break;
+        case EQ: case NEQ:
+            result = left == right || (isNumeric(left) && isNumeric(right)) ? ValueType::Flag : ValueType::Unknown;
+            break;
+        case AND: case OR:
+            result = left == ValueType::Flag && right == ValueType::Flag ? ValueType::Flag : ValueType::Unknown;
+            break;
+        default:
+            result = ValueType::Unknown;
+            break;
+    }
+    
+    if (result == ValueType::Unknown) {
+        error(id, "Operator '" + string(ast.text(id)) + "' cannot be applied to " +
+                  valueTypeName(left) + " and " + valueTypeName(right));
+    }
+    return result;
+}
+
+// ==================== Statements ====================
+
+void TypeChecker::check() {
+    inferReturnTypes();
+    statements(ast.node(ast.getRoot()).a, NO_NODE);
+}
+
+// A value stored into something of type `to`, named at target
+void TypeChecker::checkValue(NodeId value, ValueType to, NodeId target, const char* what) {
+    ValueType type = expressionType(value);
+    if (!assignable(to, type)) {
+        error(target, string(what) + " '" + string(ast.text(target)) + "' must be " +
+                      valueTypeName(to) + ", got " + valueTypeName(type));
+    }
+}
+
+void TypeChecker::checkCondition(NodeId condition) {
+    ValueType type = expressionType(condition);
+    if (!assignable(ValueType::Flag, type)) {
+        error(condition, string("Condition must be flag, got ") + valueTypeName(type));
+    }
+}
+
+// body is the Network or Init node the statements belong to
+void TypeChecker::statements(NodeId first, NodeId body) {
+    for (NodeId id = first; id != NO_NODE; id = ast.node(id).next) {
+        statement(id, body);
+    }
+}
+
+void TypeChecker::statement(NodeId id, NodeId body) {
+    const Node& node = ast.node(id);
+    
+    switch (node.kind) {
+        case NodeKind::Network:
+            for (NodeId param = node.a; param != NO_NODE; param = ast.node(param).next) {
+                types[param] = declaredType(ast.node(param).op);
+            }
+            statements(node.b, id);
+            break;
+        case NodeKind::Init:
+            statements(node.a, id);
+            break;
+        case NodeKind::Declaration:
+            types[id] = declaredType(node.op);
+            if (node.a != NO_NODE) checkValue(node.a, types[id], id, "Initializer of");
+            break;
+        case NodeKind::Assign: {
+            NodeId declaration = resolver.declarationOf(id);
+            ValueType target = declaration != NO_NODE ? declaredType(ast.node(declaration).op) : ValueType::Unknown;
+            checkValue(node.a, target, id, "Value assigned to");
+            break;
+        }
+        case NodeKind::If:
+            checkCondition(node.a);
+            statements(node.b, body);
+            statements(node.c, body);
+            break;
+        case NodeKind::Until:
+            checkCondition(node.a);
+            statements(node.b, body);
+            break;
+        case NodeKind::Iterate:
+            if (node.a != NO_NODE) statement(node.a, body);
+            if (node.b != NO_NODE) checkCondition(node.b);
+            if (node.c != NO_NODE) statement(node.c, body);
+            statements(node.d, body);
+            break;
+        case NodeKind::Forward:
+            expressionType(node.a);
+            break;
+        case NodeKind::Yield: {
+            ValueType type = expressionType(node.a);
+            ValueType result = body != NO_NODE ? types[body] : ValueType::Unknown;
+            if (!assignable(result, type)) {
+                error(id, string("Yield of ") + valueTypeName(type) + " where " +
+                          valueTypeName(result) + " is yielded elsewhere");
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef TYPE_CHECKER_H
+#define TYPE_CHECKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "diagnostics.h"
+#include "line_index.h"
+#include "resolver.h"
+
+using namespace std;
+
+// Type of a NetC value
+enum class ValueType : uint8_t {
+    Unknown,    // Not known (unresolved, linked, or already in error)
+    Dnum,       // Integer
+    Cnum,       // Float
+    Text,
+    Flag,       // Boolean
+    Void        // What a network without a yield returns
+};
+
+const char* valueTypeName(ValueType type);
+
+// TypeChecker - infers expression types bottom-up and checks their use
+// Declarations, parameters and literals have their type written down;
+// every other expression gets its type from its operands. A network's
+// return type is that of its yields (dnum and cnum yields make it cnum),
+// so calls can be typed before the callee is reached. Checked:
+// initializers, assignments and call arguments against the declared type
+// (dnum and cnum convert to each other as in C; text and flag convert to
+// nothing), operands of every operator, if/until/iterate conditions (which
+// must be flag) and yields that disagree. Unknown never causes an error, so one
+// mistake is reported once.
+// Types live in a side array indexed by node id, not in the nodes. Return
+// types are inferred first, in callee-before-caller order over the call
+// graph of the yields (a recursive call counts as Unknown while its
+// network is being inferred); then one pass checks the whole tree. Each
+// expression is typed at most twice, so the checker stays linear.
+// Operands can nest as deep as the source makes them, so expressions are
+// walked with an explicit stack; a node is typed once its operands are.
+// The compiler and the tree interpreter do recurse over expressions, so
+// one with more nested operators than the maximum depth is an error.
+class TypeChecker {
+private:
+    // A network or init() body and what its yields depend on
+    struct Body {
+        NodeId node;
+        uint32_t firstYield, yieldEnd;  // Its Yield nodes in yields
+        uint32_t firstCall, callEnd;    // Networks those yields call, in callees
+        uint8_t state;                  // 0 = not inferred, 1 = in progress, 2 = done
+    };
+    
+    // Work waiting on the expression walk's stack
+    enum class StepKind : uint8_t {
+        Visit,          // Push the operands of id, or type it if it has none
+        Finish,         // Type id from its typed operands
+        Argument        // Check argument id of call against param
+    };
+    struct Step {
+        StepKind kind;
+        NodeId id;
+        NodeId call;                    // Argument only
+        NodeId param;                   // Argument only (NO_NODE past the last)
+        uint32_t position;              // Argument only (1-based)
+    };
+    
+    const Ast& ast;
+    const Resolver& resolver;
+    const LineIndex& lines;
+    Diagnostics diagnostics;
+    
+    vector<ValueType> types;        // By node: type of an expression, the
+                                    // declared type of a Declaration/Param,
+                                    // the return type of a Network/Init
+    vector<Body> bodies;
+    vector<uint32_t> bodyOf;        // By node: index in bodies of a Network/Init
+    vector<NodeId> yields;
+    vector<NodeId> callees;
+    vector<uint32_t> heights;       // By node: operators nested in an expression,
+                                    // itself included
+    vector<Step> steps;             // Expression walk, next step last
+    vector<NodeId> pendingCalls;    // collectCalls walk
+    size_t maxDepth;                // Operators an expression may nest
+    bool quiet;                     // Inferring: type without reporting
+    size_t typed;                   // Expressions typed by the checking pass
+    
+    void error(NodeId at, const string& message);
+    bool assignable(ValueType to, ValueType from) const;
+    
+    void collectYields(NodeId first);
+    void collectCalls(NodeId id);
+    void inferReturnTypes();
+    void inferReturnType(Body& body);
+    
+    ValueType expressionType(NodeId id);
+    void checkArgument(const Step& step);
+    ValueType callType(NodeId id);
+    ValueType unaryType(NodeId id);
+    ValueType binaryType(NodeId id);
+    void checkValue(NodeId value, ValueType to, NodeId target, const char* what);
+    void checkCondition(NodeId condition);
+    void statements(NodeId first, NodeId body);
+    void statement(NodeId id, NodeId body);
+    
+public:
+    // The resolver must have resolved ast without errors
+    TypeChecker(const Ast& ast, const Resolver& resolver, const LineIndex& lines);
+    
+    // Same limit as the parser's nesting (Parser::setMaxDepth)
+    void setMaxDepth(size_t limit) { maxDepth = limit; }
+    
+    // Infer and check the whole tree (once)
+    void check();
+    
+    ValueType typeOf(NodeId id) const { return types[id]; }
+    
+    size_t expressionCount() const { return typed; }
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    bool hasError() const { return !diagnostics.empty(); }
+};
+
+#endif // TYPE_CHECKER_H
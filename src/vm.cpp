@@ -0,0 +1,252 @@
+#include "vm.h"
+#include <algorithm>
+
+using namespace std;
+
+VM::VM(const BytecodeProgram& code, const LineIndex& index, FILE* in, FILE* out)
+    : program(code), lines(index), io(in, out), registers(1 << 12), textRegisters(1 << 8),
+      globals(code.globals), textGlobals(code.textGlobals), hasResultValue(false), calls(0) {
+    resultValue.dnum = 0;
+    frames.reserve(64);
+}
+
+void VM::fault(const Instruction* at, const string& message) {
+    SourcePosition position = lines.position(program.origins[at - program.code.data()], 1);
+    diagnostics.report(DiagnosticPhase::Runtime, position.line, position.column, message);
+}
+
+string VM::result() const {
+    ValueType type = program.functions[0].result;
+    return type == ValueType::Text ? resultText : formatValue(type, resultValue);
+}
+
+// Registers of the current instruction (frame-relative)
+#define R(field) r[pc->field]
+#define T(field) t[pc->field]
+
+#if defined(__GNUC__)
+#define CASE(name) op_##name:
+#define DISPATCH() goto *dispatch[(size_t)pc->op]
+#define NEXT() do { pc++; DISPATCH(); } while (0)
+#else
+#define CASE(name) case Opcode::name:
+#define DISPATCH() continue
+#define NEXT() do { pc++; continue; } while (0)
+#endif
+
+#define JUMP(target) do { pc = code + (target); DISPATCH(); } while (0)
+
+bool VM::run() {
+    const Instruction* code = program.code.data();
+    const Value* constants = program.constants.data();
+    const BytecodeFunction& start = program.functions[0];
+    Value* g = globals.data();
+    string* tg = textGlobals.data();
+    
+    registers.resize(max<size_t>(registers.size(), start.registers));
+    textRegisters.resize(max<size_t>(textRegisters.size(), start.textRegisters));
+    frames.push_back({nullptr, 0, 0, 0});
+    
+    uint32_t base = 0, textBase = 0;
+    Value* r = registers.data();
+    string* t = textRegisters.data();
+    const Instruction* pc = code + start.entry;
+
+#if defined(__GNUC__)
+    // Label of each opcode's handler, indexed by Opcode
+    static const void* const dispatch[] = {
+        &&op_Move, &&op_MoveText, &&op_LoadInt, &&op_LoadConst, &&op_LoadText,
+        &&op_GetGlobal, &&op_SetGlobal, &&op_GetGlobalText, &&op_SetGlobalText,
+        &&op_DnumToCnum, &&op_CnumToDnum,
+        &&op_AddD, &&op_SubD, &&op_MulD, &&op_DivD, &&op_ModD,
+        &&op_NegD, &&op_IncD, &&op_DecD,
+        &&op_AddC, &&op_SubC, &&op_MulC, &&op_DivC,
+        &&op_NegC, &&op_IncC, &&op_DecC,
+        &&op_Concat,
+        &&op_BitAnd, &&op_BitOr, &&op_BitXor, &&op_ShiftLeft, &&op_ShiftRight,
+        &&op_BitNot, &&op_Not,
+        &&op_EqD, &&op_NeD, &&op_LtD, &&op_LeD,
+        &&op_EqC, &&op_NeC, &&op_LtC, &&op_LeC,
+        &&op_EqText, &&op_NeText,
+        &&op_Jump, &&op_JumpIfFalse, &&op_JumpIfTrue,
+        &&op_Call, &&op_CallText, &&op_Args,
+        &&op_Return, &&op_ReturnText, &&op_ReturnVoid,
+        &&op_FeedD, &&op_FeedC, &&op_FeedFlag, &&op_FeedText,
+        &&op_ForwardD, &&op_ForwardC, &&op_ForwardFlag, &&op_ForwardText
+    };
+    static_assert(sizeof(dispatch) / sizeof(dispatch[0]) == OPCODE_COUNT, "one handler per opcode");
+    DISPATCH();
+#else
+    for (;;) switch (pc->op) {
+#endif
+
+    CASE(Move) R(a) = R(b); NEXT();
+    CASE(MoveText) T(a) = T(b); NEXT();
+    CASE(LoadInt) R(a).dnum = (int32_t)pc->wide(); NEXT();
+    CASE(LoadConst) R(a) = constants[pc->wide()]; NEXT();
+    CASE(LoadText) T(a) = program.texts[pc->wide()]; NEXT();
+    CASE(GetGlobal) R(a) = g[pc->wide()]; NEXT();
+    CASE(SetGlobal) g[pc->wide()] = R(a); NEXT();
+    CASE(GetGlobalText) T(a) = tg[pc->wide()]; NEXT();
+    CASE(SetGlobalText) tg[pc->wide()] = T(a); NEXT();
+    CASE(DnumToCnum) R(a).cnum = (double)R(b).dnum; NEXT();
+    CASE(CnumToDnum) R(a).dnum = cnumToDnum(R(b).cnum); NEXT();
+    
+    CASE(AddD) R(a).dnum = wrapAdd(R(b).dnum, R(c).dnum); NEXT();
+    CASE(SubD) R(a).dnum = wrapSub(R(b).dnum, R(c).dnum); NEXT();
+    CASE(MulD) R(a).dnum = wrapMul(R(b).dnum, R(c).dnum); NEXT();
+    CASE(DivD)
+        if (R(c).dnum == 0) {
+            fault(pc, "Division by zero");
+            goto failed;
+        }
+        R(a).dnum = wrapDiv(R(b).dnum, R(c).dnum);
+        NEXT();
+    CASE(ModD)
+        if (R(c).dnum == 0) {
+            fault(pc, "Modulo by zero");
+            goto failed;
+        }
+        R(a).dnum = wrapMod(R(b).dnum, R(c).dnum);
+        NEXT();
+    CASE(NegD) R(a).dnum = wrapNeg(R(b).dnum); NEXT();
+    CASE(IncD) R(a).dnum = wrapAdd(R(b).dnum, 1); NEXT();
+    CASE(DecD) R(a).dnum = wrapSub(R(b).dnum, 1); NEXT();
+    
+    CASE(AddC) R(a).cnum = R(b).cnum + R(c).cnum; NEXT();
+    CASE(SubC) R(a).cnum = R(b).cnum - R(c).cnum; NEXT();
+    CASE(MulC) R(a).cnum = R(b).cnum * R(c).cnum; NEXT();
+    CASE(DivC) R(a).cnum = R(b).cnum / R(c).cnum; NEXT();
+    CASE(NegC) R(a).cnum = -R(b).cnum; NEXT();
+    CASE(IncC) R(a).cnum = R(b).cnum + 1; NEXT();
+    CASE(DecC) R(a).cnum = R(b).cnum - 1; NEXT();
+    
+    CASE(Concat)
+        if (pc->a == pc->b) {
+            T(a) += T(c);
+        } else if (pc->a != pc->c) {
+            T(a) = T(b);
+            T(a) += T(c);
+        } else {
+            T(a) = T(b) + T(c);
+        }
+        NEXT();
+    
+    CASE(BitAnd) R(a).dnum = R(b).dnum & R(c).dnum; NEXT();
+    CASE(BitOr) R(a).dnum = R(b).dnum | R(c).dnum; NEXT();
+    CASE(BitXor) R(a).dnum = R(b).dnum ^ R(c).dnum; NEXT();
+    CASE(ShiftLeft) R(a).dnum = shiftLeft(R(b).dnum, R(c).dnum); NEXT();
+    CASE(ShiftRight) R(a).dnum = shiftRight(R(b).dnum, R(c).dnum); NEXT();
+    CASE(BitNot) R(a).dnum = ~R(b).dnum; NEXT();
+    CASE(Not) R(a).dnum = !R(b).dnum; NEXT();
+    
+    CASE(EqD) R(a).dnum = R(b).dnum == R(c).dnum; NEXT();
+    CASE(NeD) R(a).dnum = R(b).dnum != R(c).dnum; NEXT();
+    CASE(LtD) R(a).dnum = R(b).dnum < R(c).dnum; NEXT();
+    CASE(LeD) R(a).dnum = R(b).dnum <= R(c).dnum; NEXT();
+    CASE(EqC) R(a).dnum = R(b).cnum == R(c).cnum; NEXT();
+    CASE(NeC) R(a).dnum = R(b).cnum != R(c).cnum; NEXT();
+    CASE(LtC) R(a).dnum = R(b).cnum < R(c).cnum; NEXT();
+    CASE(LeC) R(a).dnum = R(b).cnum <= R(c).cnum; NEXT();
+    CASE(EqText) R(a).dnum = T(b) == T(c); NEXT();
+    CASE(NeText) R(a).dnum = T(b) != T(c); NEXT();
+    
+    CASE(Jump) JUMP(pc->wide());
+    CASE(JumpIfFalse) if (!R(a).dnum) JUMP(pc->wide()); NEXT();
+    CASE(JumpIfTrue) if (R(a).dnum) JUMP(pc->wide()); NEXT();
+    
+    CASE(Call)
+    CASE(CallText) {
+        // The callee's window starts at the arguments (see Args)
+        const BytecodeFunction& callee = program.functions[pc->wide()];
+        if (frames.size() > MAX_CALL_DEPTH) {
+            fault(pc, "Too many nested calls (more than " + to_string(MAX_CALL_DEPTH) + ")");
+            goto failed;
+        }
+        uint32_t dest = (pc->op == Opcode::CallText ? textBase : base) + pc->a;
+        frames.push_back({pc + 2, base, textBase, dest});
+        base += pc[1].a;
+        textBase += pc[1].b;
+        if (base + callee.registers > registers.size()) {
+            registers.resize(max<size_t>(registers.size() * 2, base + callee.registers));
+        }
+        if (textBase + callee.textRegisters > textRegisters.size()) {
+            textRegisters.resize(max<size_t>(textRegisters.size() * 2, textBase + callee.textRegisters));
+        }
+        r = registers.data() + base;
+        t = textRegisters.data() + textBase;
+        calls++;
+        JUMP(callee.entry);
+    }
+    CASE(Args) NEXT();
+    
+    CASE(Return) {
+        Value value = R(a);
+        Frame frame = frames.back();
+        frames.pop_back();
+        if (!frame.returnPc) {
+            resultValue = value;
+            hasResultValue = true;
+            goto finished;
+        }
+        registers[frame.dest] = value;
+        base = frame.base;
+        textBase = frame.textBase;
+        r = registers.data() + base;
+        t = textRegisters.data() + textBase;
+        pc = frame.returnPc;
+        DISPATCH();
+    }
+    CASE(ReturnText) {
+        // No string local here: a computed goto out of its scope would skip
+        // its destructor. The caller's slot lies below the callee's window.
+        Frame frame = frames.back();
+        frames.pop_back();
+        if (!frame.returnPc) {
+            resultText = move(T(a));
+            hasResultValue = true;
+            goto finished;
+        }
+        textRegisters[frame.dest] = move(T(a));
+        base = frame.base;
+        textBase = frame.textBase;
+        r = registers.data() + base;
+        t = textRegisters.data() + textBase;
+        pc = frame.returnPc;
+        DISPATCH();
+    }
+    CASE(ReturnVoid) {
+        Frame frame = frames.back();
+        frames.pop_back();
+        if (!frame.returnPc) goto finished;
+        base = frame.base;
+        textBase = frame.textBase;
+        r = registers.data() + base;
+        t = textRegisters.data() + textBase;
+        pc = frame.returnPc;
+        DISPATCH();
+    }
+    
+    CASE(FeedD) R(a).dnum = io.feedDnum(); NEXT();
+    CASE(FeedC) R(a).cnum = io.feedCnum(); NEXT();
+    CASE(FeedFlag) R(a).dnum = io.feedFlag(); NEXT();
+    CASE(FeedText) T(a) = io.feedText(); NEXT();
+    CASE(ForwardD) io.forwardDnum(R(a).dnum); NEXT();
+    CASE(ForwardC) io.forwardCnum(R(a).cnum); NEXT();
+    CASE(ForwardFlag) io.forwardFlag(R(a).dnum != 0); NEXT();
+    CASE(ForwardText) io.forwardText(T(a)); NEXT();
+
+#if !defined(__GNUC__)
+    }
+#endif
+
+finished:
+    io.flush();
+    frames.clear();
+    return true;
+
+failed:
+    io.flush();
+    frames.clear();
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bytecode.h"
+#include "diagnostics.h"
+#include "line_index.h"
+#include "runtime.h"
+
+using namespace std;
+
+// VM - runs a BytecodeProgram
+// Registers of every active frame live in one growing array per bank: a
+// call slides the frame window up to the arguments the caller computed,
+// and a yield slides it back. Dispatch is a computed goto (a jump through
+// a table of label addresses at the end of every instruction), so each
+// instruction predicts its successor on its own branch; compilers without
+// label addresses fall back to a switch.
+class VM {
+public:
+    static const size_t MAX_CALL_DEPTH = 100000;
+    
+private:
+    // Where execution continues after a yield
+    struct Frame {
+        const Instruction* returnPc;    // nullptr for the start code
+        uint32_t base, textBase;        // Caller's register windows
+        uint32_t dest;                  // Caller register taking the result (absolute)
+    };
+    
+    const BytecodeProgram& program;
+    const LineIndex& lines;
+    ProgramIO io;
+    Diagnostics diagnostics;
+    
+    vector<Value> registers;
+    vector<string> textRegisters;
+    vector<Value> globals;
+    vector<string> textGlobals;
+    vector<Frame> frames;
+    Value resultValue;
+    string resultText;
+    bool hasResultValue;
+    size_t calls;                       // Network calls made
+    
+    void fault(const Instruction* at, const string& message);
+    
+public:
+    VM(const BytecodeProgram& program, const LineIndex& lines, FILE* in, FILE* out);
+    
+    // Run the program to its end; false on a runtime error
+    bool run();
+    
+    // What init() yielded, as forward would write it
+    bool hasResult() const { return hasResultValue; }
+    string result() const;
+    
+    size_t callCount() const { return calls; }
+    const Diagnostics& getDiagnostics() const { return diagnostics; }
+    bool hasError() const { return !diagnostics.empty(); }
+};
+
+#endif // VM_H
@@ -0,0 +1,95 @@
+#!/bin/bash
+# Compiles programs with very long operator chains, which the parser builds
+# as equally tall trees. Every pass after it must finish without running
+# out of native stack: each run has to end with an exit status of its own
+# (not a signal) and print the expected message.
+#
+# Usage: deep_expressions.sh <compiler>
+
+compiler=$(realpath "$1")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+# The rest of a left-deep chain of terms terms: " <op> <term>", terms - 1 times
+chain() {
+    awk -v terms="$1" -v op="$2" -v term="$3" 'BEGIN { for (i = 1; i < terms; i++) printf " %s %s", op, term }'
+}
+
+# levels calls nested in each other's argument lists, around 1
+calls() {
+    awk -v levels="$1" 'BEGIN { for (i = 0; i < levels; i++) printf "f("; printf "1"; for (i = 0; i < levels; i++) printf ")" }'
+}
+
+# Run the compiler on program with args; its output must contain expected
+expect() {
+    local name=$1 program=$2 expected=$3
+    shift 3
+    "$compiler" "$@" "$work/$program" > "$work/out" 2>&1
+    local status=$?
+    if [ $status -ge 128 ]; then
+        echo "FAIL $name: killed by signal $((status - 128))"
+        failures=$((failures + 1))
+    elif ! grep -qF "$expected" "$work/out"; then
+        echo "FAIL $name: no '$expected' in the output"
+        failures=$((failures + 1))
+    fi
+}
+
+for terms in 50000 100000 1000000; do
+    # An undeclared name at the end stops the compile after name resolution
+    echo "init() { dnum x = 1$(chain $terms + 1) + missing; forward(x); }" > "$work/undeclared_$terms.netc"
+    echo "network f(dnum a) { yield a; } init() { forward(f(1$(chain $terms '*' 1), missing)); }" > "$work/arity_$terms.netc"
+    # A text operand at the end stops it after type checking
+    echo "network g(dnum a) { yield a; } network f(dnum a) { yield a$(chain $terms - 'g(a)') + \"t\"; } init() { forward(f(1)); }" > "$work/mistyped_$terms.netc"
+    
+    expect "undeclared, $terms terms" "undeclared_$terms.netc" "Undeclared variable 'missing'"
+    expect "undeclared, $terms terms, batch" "undeclared_$terms.netc" "Undeclared variable 'missing'" --batch
+    expect "arity, $terms terms" "arity_$terms.netc" "Network 'f' expects 1 argument, got 2"
+    expect "mistyped, $terms terms" "mistyped_$terms.netc" "Operator '+' cannot be applied to dnum and text"
+    expect "mistyped, $terms terms, batch" "mistyped_$terms.netc" "Operator '+' cannot be applied to dnum and text" --batch
+    # A well-typed one is rejected by the checker, as too deep to compile
+    echo "init() { dnum x = 1$(chain $terms + 1); forward(x); }" > "$work/typed_$terms.netc"
+    expect "typed, $terms terms" "typed_$terms.netc" "Expression nesting exceeds the maximum depth of 4096" --run
+    expect "typed, $terms terms, batch" "typed_$terms.netc" "Expression nesting exceeds the maximum depth of 4096" --batch
+    expect "typed, $terms terms, folded" "typed_$terms.netc" "Expression nesting exceeds the maximum depth of 4096" --run -O
+    # Past a raised limit, the folder reduces literal chains to one literal
+    # before an engine sees them, and drops what a literal || skips
+    echo "network f(dnum a, dnum b) { yield a + b; } init() { forward(f(1$(chain $terms + 1), 2)); }" > "$work/literal_$terms.netc"
+    echo "init() { dnum y = 2; forward(true || (y$(chain $terms + y) > 0)); }" > "$work/skipped_$terms.netc"
+    for engine in vm tree; do
+        expect "literal, $terms terms, $engine" "literal_$terms.netc" "$((terms + 2))" --run=$engine -O --max-depth=$((terms * 2))
+        expect "skipped, $terms terms, $engine" "skipped_$terms.netc" "true" --run=$engine -O --max-depth=$((terms * 2))
+    done
+done
+
+# 4097 terms nest 4096 operators, the most the default allows
+echo "init() { dnum x = 1$(chain 4097 + 2); forward(x); }" > "$work/limit.netc"
+for engine in vm tree; do
+    expect "at the limit, $engine" limit.netc "8193" --run=$engine
+    expect "at the limit, $engine, folded" limit.netc "8193" --run=$engine -O
+done
+
+# Calls nest like parentheses: with init's body and the program, 4094 of
+# them are the most the default allows
+for levels in 4094 4096 4097 1000000; do
+    echo "network f(dnum a) { yield a; } init() { forward($(calls $levels)); }" > "$work/calls_$levels.netc"
+done
+for engine in vm tree; do
+    expect "4094 nested calls, $engine" calls_4094.netc "Execution completed successfully" --run=$engine
+done
+for levels in 4096 4097 1000000; do
+    expect "$levels nested calls" "calls_$levels.netc" "Nesting exceeds the maximum depth of 4096" -p
+    expect "$levels nested calls, run" "calls_$levels.netc" "Nesting exceeds the maximum depth of 4096" --run
+    expect "$levels nested calls, batch" "calls_$levels.netc" "Nesting exceeds the maximum depth of 4096" --batch
+done
+
+# The tree interpreter recurses through calls, so it stops a tall
+# expression (the call at its bottom makes it 4096) in a deep recursion
+# before the native stack runs out; the VM runs it
+echo "network f(dnum n) { if (n > 0) { yield f(n - 1)$(chain 4095 + 0); } yield 0; } init() { forward(f(1999)); }" > "$work/recursion.netc"
+expect "recursion, vm" recursion.netc "Execution completed successfully" --run=vm
+expect "recursion, tree" recursion.netc "Statements and expressions nest too deeply to run" --run=tree
+
+echo "Deep expressions: $failures failures"
+[ $failures -eq 0 ]
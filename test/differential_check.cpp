@@ -0,0 +1,375 @@
+// Checks the bytecode VM against the tree interpreter, and folded programs
+// against unfolded ones
+// Random well-typed programs (globals, networks calling the ones before
+// them, nested if/iterate/until blocks, feeds, forwards and yields over
+// every operator) are run four ways: on both engines, with and without
+// constant folding. The output, the runtime errors and what init() yields
+// must be the same every time. The files named on the command line are
+// run the same way.
+//
+// Usage: differential_check [seed] [programs] [files...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "compiler.h"
+#include "constant_folder.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+#include "tree_interpreter.h"
+#include "type_checker.h"
+#include "vm.h"
+
+using namespace std;
+
+// What the programs read with feed
+static const char* const INPUT = "3\n1.5\ntrue\nabc\n7\n";
+
+static const char* const TYPES[] = {"dnum", "cnum", "flag", "text"};
+
+// ==================== Generator ====================
+
+// ProgramGenerator - writes a random NetC program that checks cleanly
+// Loops run a handful of times and networks only call the ones defined
+// before them, so every program ends quickly.
+class ProgramGenerator {
+private:
+    struct Variable {
+        string name;
+        string type;
+    };
+    struct Network {
+        string name;
+        vector<string> params;
+        string result;
+    };
+    
+    mt19937 rng;
+    vector<Network> networks;
+    int counter = 0;
+    
+    double chance() { return uniform_real_distribution<double>(0, 1)(rng); }
+    int between(int low, int high) { return uniform_int_distribution<int>(low, high)(rng); }
+    template <typename T> const T& pick(const vector<T>& items) { return items[rng() % items.size()]; }
+    const char* anyType() { return TYPES[rng() % 4]; }
+    string fresh() { return "v" + to_string(++counter); }
+    
+    string literal(const string& type);
+    string call(const string& type, const vector<Variable>& scope, int depth, double roll);
+    string expression(const string& type, const vector<Variable>& scope, int depth = 0);
+    void statements(vector<string>& lines, vector<Variable> scope, int depth, const string& result, int count);
+    
+public:
+    explicit ProgramGenerator(unsigned seed) : rng(seed) {}
+    
+    string program();
+};
+
+string ProgramGenerator::literal(const string& type) {
+    if (type == "dnum") return to_string(between(0, 20));
+    if (type == "cnum") return to_string(between(0, 9)) + "." + to_string(between(0, 9));
+    if (type == "flag") return chance() < 0.5 ? "true" : "false";
+    static const vector<string> texts = {"a", "bc", "", "x y"};
+    return "\"" + pick(texts) + "\"";
+}
+
+// A call to a network yielding type, if roll picks one and there is one
+string ProgramGenerator::call(const string& type, const vector<Variable>& scope, int depth, double roll) {
+    vector<Network> candidates;
+    for (const Network& network : networks) {
+        if (network.result == type) candidates.push_back(network);
+    }
+    if (candidates.empty() || !roll) return "";
+    
+    const Network& network = pick(candidates);
+    string text = network.name + "(";
+    for (size_t i = 0; i < network.params.size(); i++) {
+        if (i > 0) text += ", ";
+        text += expression(network.params[i], scope, depth + 1);
+    }
+    return text + ")";
+}
+
+string ProgramGenerator::expression(const string& type, const vector<Variable>& scope, int depth) {
+    vector<string> names;
+    for (const Variable& variable : scope) {
+        if (variable.type == type) names.push_back(variable.name);
+    }
+    if (depth > 3 || chance() < 0.25) {
+        if (!names.empty() && chance() < 0.6) return pick(names);
+        return literal(type);
+    }
+    
+    double roll = chance();
+    auto operand = [&](const string& operandType) { return expression(operandType, scope, depth + 1); };
+    auto binary = [&](const string& left, const vector<string>& ops, const string& right) {
+        return "(" + operand(left) + " " + pick(ops) + " " + operand(right) + ")";
+    };
+    
+    if (type == "dnum") {
+        if (roll < 0.5) return binary("dnum", {"+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>"}, "dnum");
+        if (roll < 0.6) {
+            // Only locals and parameters are stepped
+            vector<string> steppable;
+            for (const Variable& variable : scope) {
+                if (variable.type == "dnum" && variable.name[0] != 'g' && variable.name[0] != 'i') {
+                    steppable.push_back(variable.name);
+                }
+            }
+            if (!steppable.empty()) return string("(") + (chance() < 0.5 ? "++" : "--") + pick(steppable) + ")";
+        }
+        if (roll < 0.7) return "(-" + operand("dnum") + ")";
+        if (roll < 0.75) return "(~" + operand("dnum") + ")";
+        string called = call("dnum", scope, depth, roll < 0.9);
+        return called.empty() ? literal("dnum") : called;
+    }
+    if (type == "cnum") {
+        if (roll < 0.6) return binary(chance() < 0.5 ? "cnum" : "dnum", {"+", "-", "*", "/"}, "cnum");
+        if (roll < 0.7) return "(-" + operand("cnum") + ")";
+        string called = call("cnum", scope, depth, roll < 0.9);
+        return called.empty() ? literal("cnum") : called;
+    }
+    if (type == "flag") {
+        if (roll < 0.4) {
+            string left = chance() < 0.5 ? "dnum" : "cnum";
+            return binary(left, {"<", ">", "<=", ">=", "==", "!="}, chance() < 0.5 ? "dnum" : "cnum");
+        }
+        if (roll < 0.6) return binary("flag", {"&&", "||"}, "flag");
+        if (roll < 0.7) return "(!" + operand("flag") + ")";
+        if (roll < 0.8) return binary("text", {"==", "!="}, "text");
+        return literal("flag");
+    }
+    if (roll < 0.5) return "(" + operand("text") + " + " + operand("text") + ")";
+    string called = call("text", scope, depth, roll < 0.7);
+    return called.empty() ? literal("text") : called;
+}
+
+// count statements at depth, in a body yielding result ("" at the top)
+void ProgramGenerator::statements(vector<string>& lines, vector<Variable> scope, int depth,
+                                  const string& result, int count) {
+    string indent(depth * 4, ' ');
+    for (int i = 0; i < count; i++) {
+        double roll = chance();
+        if (roll < 0.3) {
+            string type = anyType(), name = fresh();
+            lines.push_back(indent + type + " " + name + " = " + expression(type, scope) + ";");
+            scope.push_back({name, type});
+        } else if (roll < 0.45 && !scope.empty()) {
+            // Loop counters are left alone; numbers are sometimes converted.
+            // Texts are assigned without reading variables, so no loop or
+            // call chain can keep doubling one.
+            Variable target = pick(scope);
+            if (target.name[0] == 'i') continue;
+            string type = target.type;
+            if (chance() >= 0.8 && (type == "dnum" || type == "cnum")) type = type == "dnum" ? "cnum" : "dnum";
+            lines.push_back(indent + target.name + " = " + expression(type, type == "text" ? vector<Variable>() : scope) + ";");
+        } else if (roll < 0.6) {
+            lines.push_back(indent + "forward(" + expression(anyType(), scope) + ");");
+        } else if (roll < 0.7 && depth < 3) {
+            lines.push_back(indent + "if (" + expression("flag", scope) + ")");
+            lines.push_back(indent + "{");
+            statements(lines, scope, depth + 1, result, between(1, 3));
+            lines.push_back(indent + "}");
+            if (chance() < 0.5) {
+                lines.push_back(indent + "else");
+                lines.push_back(indent + "{");
+                statements(lines, scope, depth + 1, result, between(1, 3));
+                lines.push_back(indent + "}");
+            }
+        } else if (roll < 0.8 && depth < 3) {
+            string counter = "i" + fresh();
+            lines.push_back(indent + "iterate (dnum " + counter + " = 0; " + counter + " < " + to_string(between(0, 4)) +
+                            "; " + counter + " = " + counter + " + 1)");
+            lines.push_back(indent + "{");
+            vector<Variable> inner = scope;
+            inner.push_back({counter, "dnum"});
+            statements(lines, inner, depth + 1, result, between(1, 3));
+            lines.push_back(indent + "}");
+        } else if (roll < 0.87 && depth < 3) {
+            string counter = fresh();
+            lines.push_back(indent + "dnum " + counter + " = 0;");
+            lines.push_back(indent + "until (" + counter + " >= " + to_string(between(0, 3)) + ")");
+            lines.push_back(indent + "{");
+            statements(lines, scope, depth + 1, result, between(1, 2));
+            lines.push_back(indent + "    " + counter + " = " + counter + " + 1;");
+            lines.push_back(indent + "}");
+        } else if (roll < 0.9 && !result.empty()) {
+            lines.push_back(indent + "if (" + expression("flag", scope) + ")");
+            lines.push_back(indent + "{");
+            lines.push_back(indent + "    yield " + expression(result, scope) + ";");
+            lines.push_back(indent + "}");
+        } else if (roll < 0.95) {
+            string type = anyType(), name = fresh();
+            lines.push_back(indent + type + " " + name + ";");
+            lines.push_back(indent + "feed " + name + ";");
+            scope.push_back({name, type});
+        }
+    }
+}
+
+string ProgramGenerator::program() {
+    vector<string> lines;
+    vector<Variable> globals;
+    int globalCount = between(0, 3);
+    for (int i = 0; i < globalCount; i++) {
+        string type = anyType(), name = "g" + to_string(i);
+        lines.push_back(type + " " + name + " = " + literal(type) + ";");
+        globals.push_back({name, type});
+    }
+    
+    int networkCount = between(1, 5);
+    for (int i = 0; i < networkCount; i++) {
+        Network network = {"n" + to_string(i), {}, anyType()};
+        vector<Variable> scope = globals;
+        string params;
+        int paramCount = between(0, 3);
+        for (int j = 0; j < paramCount; j++) {
+            string type = anyType(), name = "p" + to_string(j);
+            network.params.push_back(type);
+            scope.push_back({name, type});
+            params += (j > 0 ? ", " : "") + type + " " + name;
+        }
+        lines.push_back("network " + network.name + "(" + params + ")");
+        lines.push_back("{");
+        statements(lines, scope, 1, network.result, between(1, 5));
+        lines.push_back("    yield " + expression(network.result, scope) + ";");
+        lines.push_back("}");
+        networks.push_back(network);
+    }
+    
+    lines.push_back("init()");
+    lines.push_back("{");
+    statements(lines, globals, 1, "dnum", between(3, 10));
+    lines.push_back("    yield 0;");
+    lines.push_back("}");
+    
+    string text;
+    for (const string& line : lines) text += line + "\n";
+    return text;
+}
+
+// ==================== Running ====================
+
+// Everything a run of a program shows
+struct Outcome {
+    string problem;         // Why it did not run (compile errors), if it did not
+    bool ok = false;
+    string output;
+    string result;          // What init() yielded, if anything
+    string errors;          // Runtime errors
+    
+    bool operator==(const Outcome& other) const {
+        return problem == other.problem && ok == other.ok && output == other.output &&
+               result == other.result && errors == other.errors;
+    }
+};
+
+static string contents(FILE* file) {
+    string text;
+    rewind(file);
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, read);
+    return text;
+}
+
+// Compile source (folding constants if asked) and run it on one engine
+static Outcome run(const string& source, bool tree, bool fold) {
+    Outcome outcome;
+    Scanner scanner(source);
+    Parser parser(scanner.scanBuffer());
+    parser.setVerbosity(-1);
+    parser.parse();
+    if (!scanner.getDiagnostics().empty() || parser.hasError()) {
+        outcome.problem = scanner.getDiagnostics().render() + parser.getDiagnostics().render();
+        return outcome;
+    }
+    
+    Resolver resolver(parser.getAst(), scanner.getInterner(), scanner.lineIndex());
+    resolver.resolve();
+    if (resolver.hasError()) {
+        outcome.problem = resolver.getDiagnostics().render();
+        return outcome;
+    }
+    TypeChecker checker(parser.getAst(), resolver, scanner.lineIndex());
+    checker.check();
+    if (checker.hasError()) {
+        outcome.problem = checker.getDiagnostics().render();
+        return outcome;
+    }
+    if (fold) ConstantFolder(parser.getAst()).fold();
+    
+    FILE* in = tmpfile();
+    FILE* out = tmpfile();
+    fputs(INPUT, in);
+    rewind(in);
+    if (tree) {
+        TreeInterpreter interpreter(parser.getAst(), resolver, checker, scanner.lineIndex(), in, out);
+        outcome.ok = interpreter.run();
+        if (interpreter.hasResult()) outcome.result = interpreter.result();
+        outcome.errors = interpreter.getDiagnostics().render();
+    } else {
+        BytecodeProgram program;
+        BytecodeCompiler compiler(parser.getAst(), resolver, checker, scanner.lineIndex());
+        if (!compiler.compile(program)) {
+            outcome.problem = compiler.getDiagnostics().render();
+        } else {
+            VM vm(program, scanner.lineIndex(), in, out);
+            outcome.ok = vm.run();
+            if (vm.hasResult()) outcome.result = vm.result();
+            outcome.errors = vm.getDiagnostics().render();
+        }
+    }
+    outcome.output = contents(out);
+    fclose(in);
+    fclose(out);
+    return outcome;
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    int count = argc > 2 ? atoi(argv[2]) : 500;
+    vector<string> names;
+    vector<string> sources;
+    for (int i = 3; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        stringstream text;
+        text << in.rdbuf();
+        names.push_back(argv[i]);
+        sources.push_back(text.str());
+    }
+    for (int i = 0; i < count; i++) {
+        names.push_back("random program " + to_string(i) + " (seed " + to_string(seed) + ")");
+        sources.push_back(ProgramGenerator(seed + i).program());
+    }
+    
+    size_t mismatches = 0, faults = 0;
+    for (size_t i = 0; i < sources.size(); i++) {
+        Outcome reference = run(sources[i], true, false);
+        // A random program that does not compile is the generator's fault
+        bool generated = i + count >= sources.size();
+        bool failed = generated && !reference.problem.empty();
+        for (int way = 1; way < 4 && !failed; way++) {
+            bool tree = way == 2, fold = way >= 2;
+            if (run(sources[i], tree, fold) == reference) continue;
+            printf("MISMATCH %s: the %s%s differs from the unfolded tree interpreter\n", names[i].c_str(),
+                   tree ? "tree interpreter" : "VM", fold ? " with folding" : "");
+            failed = true;
+        }
+        if (failed && !reference.problem.empty()) {
+            printf("MISMATCH %s: does not compile\n%s", names[i].c_str(), reference.problem.c_str());
+        }
+        if (!reference.ok) faults++;
+        if (failed) mismatches++;
+    }
+    printf("Differential: %zu programs (%zu stopped by runtime errors), %zu mismatches\n",
+           sources.size(), faults, mismatches);
+    return mismatches != 0;
+}
@@ -0,0 +1,162 @@
+// Checks EditSession::edit against sessions and parses of the edited text
+// Each source is opened in a session and edited at random: bytes are
+// removed and pieces of source (or single characters that open strings,
+// comments and blocks) inserted anywhere. A second session only inserts
+// blank space between tokens, so a source that parses keeps parsing.
+// After every edit the session must agree with
+//   - a full scan of its text: tokens, names, positions and line starts;
+//   - a session opened on its text: tree, diagnostics and error flag;
+//   - a full parse of its text, when that parses without errors.
+// Symbol ids differ between sessions, so trees are compared by name.
+//
+// Usage: edit_session_check [seed] [edits per source] [files...]
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "edit_session.h"
+#include "parser.h"
+
+using namespace std;
+
+// Pieces inserted by the edits
+static const char* const SNIPPETS[] = {
+    "a", "1", ".", "5", " ", "\n", "\"", "#", "{", "}", "(", ")", ";", "@", "\n\n    ", "yield",
+    "network f(dnum x) { yield x; }\n", "init() { dnum y = 2; }\n", "link \"m.netc\";\n",
+    "dnum q = 3 + 4;\n", "if (a < b) { x = 1; } else { x = 2; }", "\"str\nx\""
+};
+
+// Pieces inserted by the layout edits
+static const char* const BLANKS[] = {" ", "  ", "\n", "\n\n    "};
+
+// Node kinds whose d field holds the symbol id of their name
+static bool isNamed(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::Network:
+        case NodeKind::Param:
+        case NodeKind::Declaration:
+        case NodeKind::Assign:
+        case NodeKind::Feed:
+        case NodeKind::Identifier:
+        case NodeKind::Call:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Trees x and y are the same node for node, with names compared as text
+static bool sameAst(const Ast& x, const Ast& y, const Interner& xNames, const Interner& yNames) {
+    if (x.size() != y.size() || x.getRoot() != y.getRoot()) return false;
+    for (size_t i = 1; i <= x.size(); i++) {
+        Node p = x.node(i), q = y.node(i);
+        // The root counts definitions, which a session does not keep
+        if (p.kind == NodeKind::Program) p.count = q.count = 0;
+        if (p.length == 0) p.offset = q.offset = 0;
+        if (isNamed(p.kind) && p.kind == q.kind) {
+            if (p.d == NO_NODE || xNames.name(p.d) != yNames.name(q.d)) return false;
+            if (xNames.name(p.d) != x.text(i)) return false;
+            p.d = q.d = NO_NODE;
+        }
+        if (memcmp(&p, &q, sizeof(Node)) != 0) return false;
+    }
+    return true;
+}
+
+// The session agrees with a full scan, a fresh session and a full parse
+static bool consistent(const EditSession& session, size_t& fullParses) {
+    string text(session.text());
+    Scanner scanner(text);
+    const TokenBuffer& scanned = scanner.scanBuffer();
+    const TokenBuffer& tokens = session.getTokens();
+    
+    if (scanned.size() != tokens.size()) return false;
+    for (size_t i = 0; i < scanned.size(); i++) {
+        if (scanned.type(i) != tokens.type(i) || scanned.offset(i) != tokens.offset(i) ||
+            scanned.length(i) != tokens.length(i)) {
+            return false;
+        }
+        if ((scanned.type(i) == IDENTIFIER) != (tokens.symbol(i) != 0)) return false;
+        if (scanner.getInterner().name(scanned.symbol(i)) != session.getInterner().name(tokens.symbol(i))) return false;
+    }
+    if (scanned.lineIndex().lineStarts() != tokens.lineIndex().lineStarts()) return false;
+    
+    // Scanner errors come first in the session's diagnostics
+    string lexical = scanner.getDiagnostics().render();
+    string rendered = session.diagnostics().render();
+    if (rendered.compare(0, lexical.size(), lexical) != 0) return false;
+    
+    EditSession fresh(text);
+    Ast edited, reopened;
+    session.buildAst(edited);
+    fresh.buildAst(reopened);
+    if (!sameAst(edited, reopened, session.getInterner(), fresh.getInterner())) return false;
+    if (rendered != fresh.diagnostics().render() || session.hasError() != fresh.hasError()) return false;
+    
+    Parser parser(scanned);
+    parser.setVerbosity(-1);
+    parser.parse();
+    if (parser.hasError()) return true;
+    fullParses++;
+    Diagnostics all = scanner.getDiagnostics();
+    all.append(parser.getDiagnostics());
+    return sameAst(edited, parser.getAst(), session.getInterner(), scanner.getInterner()) && rendered == all.render();
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    int edits = argc > 2 ? atoi(argv[2]) : 200;
+    vector<string> names;
+    vector<string> sources;
+    for (int i = 3; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        stringstream text;
+        text << in.rdbuf();
+        names.push_back(argv[i]);
+        sources.push_back(text.str());
+    }
+    names.push_back("empty source");
+    sources.push_back("");
+    
+    mt19937 rng(seed);
+    size_t checks = 0, fullParses = 0, mismatches = 0;
+    for (size_t i = 0; i < sources.size(); i++) {
+        for (bool layout : {false, true}) {
+            EditSession session(sources[i]);
+            for (int e = 0; e <= edits; e++) {
+                size_t offset = 0, length = 0;
+                string replacement;
+                // Check the opened session first, then after each edit
+                if (e > 0) {
+                    string_view text = session.text();
+                    offset = rng() % (text.size() + 1);
+                    size_t pieces = rng() % 3;
+                    if (layout) {
+                        // Blank space is only inserted next to blank space
+                        while (offset < text.size() && !isspace((unsigned char)text[offset])) offset++;
+                        for (size_t j = 0; j < pieces; j++) replacement += BLANKS[rng() % (sizeof(BLANKS) / sizeof(BLANKS[0]))];
+                    } else {
+                        length = rng() % 3 == 0 ? rng() % 6 : 0;
+                        for (size_t j = 0; j < pieces; j++) replacement += SNIPPETS[rng() % (sizeof(SNIPPETS) / sizeof(SNIPPETS[0]))];
+                    }
+                    session.edit(offset, length, replacement);
+                }
+                checks++;
+                if (consistent(session, fullParses)) continue;
+                if (mismatches < 10) {
+                    printf("MISMATCH %s: %s edit %d (offset %zu, length %zu, %zu bytes inserted, seed %u)\n",
+                           names[i].c_str(), layout ? "layout" : "random", e, offset, length, replacement.size(), seed);
+                }
+                mismatches++;
+            }
+        }
+    }
+    printf("Edit session: %zu states checked (%zu fully parsed), %zu mismatches\n", checks, fullParses, mismatches);
+    return mismatches != 0;
+}
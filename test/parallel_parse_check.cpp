@@ -0,0 +1,105 @@
+// Checks Parser::parseParallel against a sequential parse
+// Every source is parsed once with parse() and then with parseParallel()
+// on several thread counts and segment sizes, down to one token so each
+// top-level statement is a run of its own. The tree, the syntax errors and
+// the error flag must match. Sources are the files named on the command
+// line plus random programs of many definitions, a few of them broken by
+// deleted or stray characters, so several runs report errors at once and
+// the sequential tail takes over at different points.
+//
+// Usage: parallel_parse_check [seed] [files...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "parser.h"
+#include "scanner.h"
+
+using namespace std;
+
+// Top-level statements random programs are made of
+static const char* const DEFINITIONS[] = {
+    "network f(dnum x) { yield x * 2; }\n",
+    "network g(cnum a, flag b) { if (b) { yield a; } else { yield -a; } }\n",
+    "network h(text s) { text t = s + \"!\"; forward(t); yield t; }\n",
+    "network loop(dnum n) {\n    iterate (dnum i = 0; i < n; i = i + 1) { forward(i); }\n    yield n;\n}\n",
+    "init() { dnum y = f(2); until (y > 10) { y = y + 1; } forward(y); }\n",
+    "link \"m.netc\";\n",
+    "dnum total = (1 + 2) * 3;\n",
+    "network s() { text q = \"two\nlines\"; yield q; }\n"
+};
+
+// Characters inserted to break a definition
+static const char STRAY[] = "{}();,=+@#\"";
+
+static string randomProgram(mt19937& rng) {
+    string text;
+    size_t count = 1 + rng() % 40;
+    bool broken = rng() % 4 != 0;
+    for (size_t i = 0; i < count; i++) {
+        string definition = DEFINITIONS[rng() % (sizeof(DEFINITIONS) / sizeof(DEFINITIONS[0]))];
+        if (broken && rng() % 6 == 0) {
+            size_t at = rng() % definition.size();
+            if (rng() % 2) definition.erase(at, 1);
+            else definition.insert(at, 1, STRAY[rng() % (sizeof(STRAY) - 1)]);
+        }
+        text += definition;
+    }
+    return text;
+}
+
+// What a parse produced: tree, errors and error flag
+static string parseResult(Parser& parser) {
+    stringstream out;
+    parser.getAst().dump(out);
+    out << parser.getDiagnostics().render() << parser.hasError();
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    vector<string> names;
+    vector<string> sources;
+    for (int i = 2; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        stringstream text;
+        text << in.rdbuf();
+        names.push_back(argv[i]);
+        sources.push_back(text.str());
+    }
+    mt19937 rng(seed);
+    for (int i = 0; i < 200; i++) {
+        names.push_back("random program " + to_string(i) + " (seed " + to_string(seed) + ")");
+        sources.push_back(randomProgram(rng));
+    }
+    
+    size_t mismatches = 0, failing = 0;
+    for (size_t i = 0; i < sources.size(); i++) {
+        Scanner refScanner(sources[i]);
+        Parser ref(refScanner.scanBuffer());
+        ref.setVerbosity(-1);
+        ref.parse();
+        string expected = parseResult(ref);
+        if (ref.hasError()) failing++;
+        
+        for (size_t segment : {1, 16, 200}) {
+            for (unsigned jobs : {2u, 4u, 8u}) {
+                // A fresh scan each time, so the runs find the line index unbuilt
+                Scanner scanner(sources[i]);
+                Parser parser(scanner.scanBuffer());
+                parser.setVerbosity(-1);
+                parser.parseParallel(jobs, segment);
+                if (parseResult(parser) == expected) continue;
+                printf("MISMATCH %s: segments of %zu tokens, %u jobs\n", names[i].c_str(), segment, jobs);
+                mismatches++;
+            }
+        }
+    }
+    printf("Parallel parse: %zu sources (%zu with syntax errors), %zu mismatches\n",
+           sources.size(), failing, mismatches);
+    return mismatches != 0;
+}
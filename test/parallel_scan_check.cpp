@@ -0,0 +1,93 @@
+// Checks Scanner::scanBufferParallel against a sequential scan
+// Every source is scanned once with scanTokens() and then in parallel with
+// several thread counts and chunk sizes (down to one byte, so chunks are
+// cut inside strings, comments and blank runs), in both scan modes. The
+// tokens, their symbols and positions, and the lexical errors must match.
+// Sources are the files named on the command line plus random token soup.
+//
+// Usage: parallel_scan_check [seed] [files...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "scanner.h"
+
+using namespace std;
+
+// Pieces random sources are made of, including ones that span lines
+static const char* const SNIPPETS[] = {
+    "a", "1", "2.5", ".", " ", "\n", "\t", "\"", "\"str\nx\"", "\"two words\"", "#", "@",
+    "{", "}", "(", ")", ";", ",", "+", "<<", ">=", "&&", "++", "==",
+    "network f(dnum x) { yield x; }\n", "init() { dnum y = 2; }\n",
+    "link \"m.netc\";\n", "dnum q = 3 + 4;\n", "\n\n    ", "yield", "if (a < b) { x = 1; } else { x = 2; }"
+};
+
+static string randomSource(mt19937& rng) {
+    string text;
+    size_t pieces = rng() % 400;
+    for (size_t i = 0; i < pieces; i++) text += SNIPPETS[rng() % (sizeof(SNIPPETS) / sizeof(SNIPPETS[0]))];
+    return text;
+}
+
+// Compare one parallel scan of source with the sequential scan ref
+static bool sameScan(const string& source, ScanMode mode, Scanner& ref, unsigned jobs, size_t chunk) {
+    const vector<Token>& tokens = ref.getTokens();
+    Scanner parallel(source);
+    parallel.setMode(mode);
+    const TokenBuffer& buffer = parallel.scanBufferParallel(jobs, chunk);
+    
+    if (buffer.size() != tokens.size()) return false;
+    if (parallel.getDiagnostics().render() != ref.getDiagnostics().render()) return false;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (buffer.type(i) != token.type || buffer.symbol(i) != token.symbol ||
+            buffer.offset(i) != token.offset || buffer.length(i) != token.lexeme.size()) {
+            return false;
+        }
+        SourcePosition got = buffer.lineIndex().position(buffer.offset(i), buffer.length(i));
+        SourcePosition expected = ref.lineIndex().position(token);
+        if (got.line != expected.line || got.column != expected.column) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    vector<string> names;
+    vector<string> sources;
+    for (int i = 2; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        stringstream text;
+        text << in.rdbuf();
+        names.push_back(argv[i]);
+        sources.push_back(text.str());
+    }
+    mt19937 rng(seed);
+    for (int i = 0; i < 200; i++) {
+        names.push_back("random source " + to_string(i) + " (seed " + to_string(seed) + ")");
+        sources.push_back(randomSource(rng));
+    }
+    
+    size_t mismatches = 0;
+    for (size_t i = 0; i < sources.size(); i++) {
+        for (ScanMode mode : {ScanMode::Switch, ScanMode::Table}) {
+            Scanner ref(sources[i]);
+            ref.setMode(mode);
+            ref.scanTokens();
+            for (size_t chunk : {1, 7, 64, 1000}) {
+                for (unsigned jobs : {1u, 3u, 8u}) {
+                    if (sameScan(sources[i], mode, ref, jobs, chunk)) continue;
+                    printf("MISMATCH %s: %s mode, chunk %zu, %u jobs\n", names[i].c_str(),
+                           mode == ScanMode::Table ? "table" : "switch", chunk, jobs);
+                    mismatches++;
+                }
+            }
+        }
+    }
+    printf("Parallel scan: %zu sources, %zu mismatches\n", sources.size(), mismatches);
+    return mismatches != 0;
+}
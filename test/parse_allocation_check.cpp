@@ -0,0 +1,105 @@
+// Checks that parsing allocates nothing per token
+// A source (test-parse.netc, by default) is repeated 1, 100 and 10,000
+// times and parsed from a token list, from a token buffer and while
+// scanning. Global operator new counts the heap allocations parse() makes:
+// setting up the tree's arena and the token ring, sized up front, so
+// 10,000 copies may allocate no more often than 100.
+//
+// Usage: parse_allocation_check [file]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include "parser.h"
+#include "scanner.h"
+
+using namespace std;
+
+// Allocations made while counting is set
+static size_t allocations = 0;
+static bool counting = false;
+
+void* operator new(size_t size) {
+    if (counting) allocations++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+// Ways to feed the parser
+enum class Input { List, Buffer, Streaming };
+
+static const char* inputName(Input input) {
+    switch (input) {
+        case Input::List: return "token list";
+        case Input::Buffer: return "token buffer";
+        default: return "streaming";
+    }
+}
+
+// Allocations made by parse() on source; tokens gets the count parsed
+static size_t parseAllocations(const string& source, Input input, size_t& tokens) {
+    Scanner scanner(source);
+    Parser* parser;
+    if (input == Input::List) parser = new Parser(scanner.scanTokens(), scanner.lineIndex());
+    else if (input == Input::Buffer) parser = new Parser(scanner.scanBuffer());
+    else parser = new Parser(scanner);
+    parser->setVerbosity(-1);
+    
+    allocations = 0;
+    counting = true;
+    parser->parse();
+    counting = false;
+    
+    tokens = parser->tokenCount();
+    bool failed = parser->hasError();
+    delete parser;
+    if (failed) {
+        printf("FAIL the source does not parse\n");
+        exit(1);
+    }
+    return allocations;
+}
+
+int main(int argc, char** argv) {
+    const char* file = argc > 1 ? argv[1] : "src/test-parse.netc";
+    ifstream in(file, ios::binary);
+    stringstream text;
+    text << in.rdbuf();
+    string unit = text.str();
+    if (unit.empty()) {
+        printf("FAIL cannot read %s\n", file);
+        return 1;
+    }
+    
+    size_t failures = 0;
+    for (Input input : {Input::List, Input::Buffer, Input::Streaming}) {
+        size_t small = 0, smallTokens = 0;
+        for (size_t copies : {1, 100, 10000}) {
+            string source;
+            source.reserve(unit.size() * copies);
+            for (size_t i = 0; i < copies; i++) source += unit;
+            
+            size_t tokens;
+            size_t count = parseAllocations(source, input, tokens);
+            printf("%s, %zu copies: %zu tokens, %zu allocations\n", inputName(input), copies, tokens, count);
+            if (copies == 100) {
+                small = count;
+                smallTokens = tokens;
+            }
+            if (copies == 10000 && count > small) {
+                printf("FAIL %s: %zu allocations for %zu tokens, %zu for %zu\n", inputName(input),
+                       count, tokens, small, smallTokens);
+                failures++;
+            }
+        }
+    }
+    printf("Parse allocations: %zu failures\n", failures);
+    return failures != 0;
+}